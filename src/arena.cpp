@@ -0,0 +1,252 @@
+#include "arena.h"
+#include "utils.h"
+#include "resources.h"
+
+#include <iostream>
+
+snake::Arena::Arena(int width, int height, int snakeCount, uint64_t seed, int threads)
+    : width(width), height(height), snakeCount(snakeCount), rngState(seed), pool(threads)
+{
+    // 与Direction一致：NORTH, WEST, SOUTH, EAST
+    steps[NORTH] = -(width + 2);
+    steps[WEST] = -1;
+    steps[SOUTH] = width + 2;
+    steps[EAST] = 1;
+
+    headCell.assign(snakeCount, 0);
+    nextHead.assign(snakeCount, 0);
+    direction.assign(snakeCount, 0);
+    length.assign(snakeCount, 0);
+    bodyStart.assign(snakeCount, 0);
+    pendingGrowth.assign(snakeCount, 0);
+    alive.assign(snakeCount, 0);
+    ate.assign(snakeCount, 0);
+    died.assign(snakeCount, 0);
+    respawnTimer.assign(snakeCount, 0);
+    snakeRng.assign(snakeCount, 0);
+    bodyCells.assign(static_cast<size_t>(snakeCount) * constants::ARENA_MAX_LENGTH, 0);
+
+    grid.assign(static_cast<size_t>(width + 2) * (height + 2), EMPTY);
+    for (int i = -1; i <= width; i++) {
+        grid[index(i, -1)] = WALL;
+        grid[index(i, height)] = WALL;
+    }
+    for (int i = 0; i < height; i++) {
+        grid[index(-1, i)] = WALL;
+        grid[index(width, i)] = WALL;
+    }
+    claims.reset(new std::atomic<uint8_t>[grid.size()]);
+    for (size_t i = 0; i < grid.size(); i++) {
+        claims[i].store(0, std::memory_order_relaxed);
+    }
+
+    for (int id = 0; id < snakeCount; id++) {
+        snakeRng[id] = seed ^ (0x9E3779B97F4A7C15ull * (id + 1));
+        spawnSnake(id);
+    }
+    for (int i = 0; i < snakeCount / 2; i++) {
+        spawnApple();
+    }
+    std::cout << "Arena created: " << width << "x" << height << ", " << snakeCount << " snakes, "
+        << pool.size() << " threads" << std::endl;
+}
+
+snake::Arena::~Arena()
+{
+    resources::destroyTexture(texture);
+}
+
+int snake::Arena::getAliveCount() const
+{
+    int count = 0;
+    for (auto a : alive) count += a;
+    return count;
+}
+
+int snake::Arena::randomEmptyCell()
+{
+    utils::Rng rng(rngState);
+    int cell = -1;
+    // 地图足够空时几次就能找到，找不到就放弃这次生成
+    for (int tries = 0; tries < 64; tries++) {
+        int candidate = index(rng() % width, rng() % height);
+        if (grid[candidate] == EMPTY) {
+            cell = candidate;
+            break;
+        }
+    }
+    rngState = rng.state;
+    return cell;
+}
+
+void snake::Arena::spawnSnake(int id)
+{
+    int cell = randomEmptyCell();
+    if (cell < 0) {
+        alive[id] = 0;
+        respawnTimer[id] = constants::ARENA_RESPAWN_TICKS;
+        return;
+    }
+    headCell[id] = cell;
+    nextHead[id] = cell;
+    direction[id] = static_cast<uint8_t>(rngState & 3);
+    length[id] = 1;
+    bodyStart[id] = 0;
+    bodyAt(id, 0) = cell;
+    pendingGrowth[id] = constants::ARENA_INIT_LENGTH - 1;
+    alive[id] = 1;
+    grid[cell] = id + 1;
+}
+
+void snake::Arena::spawnApple()
+{
+    int cell = randomEmptyCell();
+    if (cell >= 0) grid[cell] = APPLE;
+}
+
+uint8_t snake::greedyController(const Arena& arena, int id, uint64_t& state)
+{
+    utils::Rng rng(state);
+    uint8_t current = arena.directionOf(id);
+    uint8_t options[3] = { current, static_cast<uint8_t>((current + 1) & 3), static_cast<uint8_t>((current + 3) & 3) };
+    int head = arena.headOf(id);
+
+    // 苹果 > 直行 > 转弯，转弯带一点随机，偶尔会主动拐弯
+    int bestScore = -1;
+    uint8_t best = current;
+    for (auto dir : options) {
+        uint32_t cell = arena.cellAt(head + arena.step(dir));
+        int score = 0;
+        if (cell == Arena::APPLE) score = 40;
+        else if (cell == Arena::EMPTY) score = dir == current ? 20 + (rng() & 7) : 10 + (rng() & 15);
+        if (score > bestScore) {
+            bestScore = score;
+            best = dir;
+        }
+    }
+    state = rng.state;
+    return best;
+}
+
+// 阶段1：各条蛇决定方向，只读占用表
+void snake::Arena::decide(size_t begin, size_t end)
+{
+    for (size_t i = begin; i < end; i++) {
+        if (!alive[i]) continue;
+        uint8_t dir = controller(*this, static_cast<int>(i), snakeRng[i]);
+        // 不能调头
+        if ((dir ^ 2) != direction[i]) direction[i] = dir & 3;
+        nextHead[i] = headCell[i] + steps[direction[i]];
+    }
+}
+
+// 阶段2：释放蛇尾，并登记蛇头要进入的格子。每条蛇只写自己的蛇尾格，互不冲突
+void snake::Arena::releaseTails(size_t begin, size_t end)
+{
+    for (size_t i = begin; i < end; i++) {
+        if (!alive[i]) continue;
+        if (pendingGrowth[i] > 0 && length[i] < constants::ARENA_MAX_LENGTH) {
+            pendingGrowth[i] -= 1;
+        }
+        else {
+            grid[bodyAt(i, 0)] = EMPTY;
+            bodyStart[i] = (bodyStart[i] + 1) % constants::ARENA_MAX_LENGTH;
+            length[i] -= 1;
+        }
+    }
+}
+
+void snake::Arena::claim(size_t begin, size_t end)
+{
+    for (size_t i = begin; i < end; i++) {
+        if (alive[i]) claims[nextHead[i]].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+// 阶段3：碰撞判定。撞到墙或任何蛇身即死亡，两个以上蛇头进入同一格则全部死亡，
+// 与处理顺序无关，所以结果是确定的。循环体没有分支，便于编译器向量化。
+void snake::Arena::resolve(size_t begin, size_t end)
+{
+    for (size_t i = begin; i < end; i++) {
+        uint32_t cell = grid[nextHead[i]];
+        uint8_t wasAlive = alive[i];
+        uint8_t hit = (cell != EMPTY) & (cell != APPLE);
+        uint8_t clash = claims[nextHead[i]].load(std::memory_order_relaxed) > 1;
+        uint8_t survive = wasAlive & !(hit | clash);
+        died[i] = wasAlive & !survive;
+        ate[i] = survive & (cell == APPLE);
+        alive[i] = survive;
+    }
+}
+
+// 阶段4：写入新蛇头、清除死亡的蛇。存活蛇头的格子各不相同，死蛇的蛇身也只属于自己
+void snake::Arena::commit(size_t begin, size_t end)
+{
+    for (size_t i = begin; i < end; i++) {
+        if (alive[i] | died[i]) claims[nextHead[i]].store(0, std::memory_order_relaxed);
+        if (alive[i]) {
+            int cell = nextHead[i];
+            grid[cell] = static_cast<uint32_t>(i + 1);
+            bodyAt(i, length[i]) = cell;
+            length[i] += 1;
+            headCell[i] = cell;
+            if (ate[i] && pendingGrowth[i] < 255) pendingGrowth[i] += 1;
+        }
+        else if (died[i]) {
+            for (int k = 0; k < length[i]; k++) {
+                grid[bodyAt(i, k)] = EMPTY;
+            }
+            length[i] = 0;
+            respawnTimer[i] = constants::ARENA_RESPAWN_TICKS;
+        }
+    }
+}
+
+void snake::Arena::tick()
+{
+    pool.parallelFor(snakeCount, [this](size_t begin, size_t end) { decide(begin, end); });
+    pool.parallelFor(snakeCount, [this](size_t begin, size_t end) {
+        releaseTails(begin, end);
+        claim(begin, end);
+    });
+    pool.parallelFor(snakeCount, [this](size_t begin, size_t end) { resolve(begin, end); });
+    pool.parallelFor(snakeCount, [this](size_t begin, size_t end) { commit(begin, end); });
+
+    // 串行部分按id顺序处理，共用的随机数才能保持确定
+    for (int i = 0; i < snakeCount; i++) {
+        if (ate[i]) spawnApple();
+        if (!alive[i] && respawnTimer[i] > 0 && --respawnTimer[i] == 0) {
+            spawnSnake(i);
+        }
+    }
+    tickCount += 1;
+}
+
+void snake::Arena::draw(SDL_Renderer* renderer, const SDL_FRect& area)
+{
+    if (!texture) {
+        texture = resources::createTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, width, height);
+        if (!texture) {
+            std::cerr << "Arena: Failed to create texture: " << SDL_GetError() << std::endl;
+            return;
+        }
+        SDL_SetTextureScaleMode(texture, SDL_SCALEMODE_NEAREST);
+        pixels.assign(static_cast<size_t>(width) * height, 0);
+    }
+
+    const uint32_t background = 0xFF000000u | (constants::color_gridbg.r << 16) |
+        (constants::color_gridbg.g << 8) | constants::color_gridbg.b;
+    for (int y = 0; y < height; y++) {
+        const uint32_t* row = &grid[index(0, y)];
+        uint32_t* out = &pixels[static_cast<size_t>(y) * width];
+        for (int x = 0; x < width; x++) {
+            uint32_t cell = row[x];
+            if (cell == EMPTY) out[x] = background;
+            else if (cell == APPLE) out[x] = 0xFFFF3030u;
+            // 按id给每条蛇一个亮色
+            else out[x] = 0xFF808080u | (cell * 0x9E3779B1u);
+        }
+    }
+    SDL_UpdateTexture(texture, NULL, pixels.data(), width * sizeof(uint32_t));
+    SDL_RenderTexture(renderer, texture, NULL, &area);
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "constants.h"
+#include "thread_pool.h"
+
+#include <SDL3/SDL.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace snake {
+    class Arena;
+
+    // 决定第id条蛇下一步的方向，返回值为Direction。rng是这条蛇自己的随机数状态。
+    using ArenaController = uint8_t (*)(const Arena& arena, int id, uint64_t& rng);
+    uint8_t greedyController(const Arena& arena, int id, uint64_t& rng);
+}
+
+// 多蛇竞技场。所有蛇的数据按struct-of-arrays存放，共享一张占用表；
+// 每个tick分为若干阶段，每个阶段内各条蛇互不依赖，可以切分到多个核心上并行，
+// 结果与线程数和切分方式无关。
+class snake::Arena {
+public:
+    // 占用表中的特殊值，其余值为 蛇的id + 1
+    static constexpr uint32_t EMPTY = 0;
+    static constexpr uint32_t APPLE = 0xFFFFFFFE;
+    static constexpr uint32_t WALL = 0xFFFFFFFF;
+
+    Arena(int width, int height, int snakeCount, uint64_t seed, int threads = 0);
+    ~Arena();
+
+    void setController(ArenaController controller) {
+        this->controller = controller;
+    }
+    void tick();
+    // 把整张地图缩放绘制到area中，每格一个像素
+    void draw(SDL_Renderer* renderer, const SDL_FRect& area);
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    int getSnakeCount() const { return snakeCount; }
+    int getAliveCount() const;
+    uint32_t getTick() const { return tickCount; }
+
+    // 供controller读取
+    int index(int x, int y) const {
+        return (y + 1) * (width + 2) + (x + 1);
+    }
+    uint32_t cellAt(int cell) const { return grid[cell]; }
+    int headOf(int id) const { return headCell[id]; }
+    uint8_t directionOf(int id) const { return direction[id]; }
+    // 相邻格子的下标偏移，按Direction排列
+    int step(uint8_t dir) const { return steps[dir]; }
+
+private:
+    int width, height;
+    int snakeCount;
+    int steps[4];
+    uint32_t tickCount = 0;
+    uint64_t rngState; // 苹果和复活位置共用，只在串行阶段使用
+    ArenaController controller = greedyController;
+    utils::ThreadPool pool;
+
+    // 蛇的数据，下标为蛇的id
+    std::vector<int32_t> headCell;
+    std::vector<int32_t> nextHead;
+    std::vector<uint8_t> direction;
+    std::vector<uint16_t> length;
+    std::vector<uint16_t> bodyStart;   // 环形缓冲中蛇尾的位置
+    std::vector<uint8_t> pendingGrowth;
+    std::vector<uint8_t> alive;
+    std::vector<uint8_t> ate;
+    std::vector<uint8_t> died;
+    std::vector<uint16_t> respawnTimer;
+    std::vector<uint64_t> snakeRng;
+    std::vector<int32_t> bodyCells;    // 每条蛇ARENA_MAX_LENGTH个格子的环形缓冲
+
+    std::vector<uint32_t> grid;        // 共享占用表，四周一圈墙
+    std::unique_ptr<std::atomic<uint8_t>[]> claims; // 本tick有几个蛇头要进入该格
+
+    int32_t& bodyAt(int id, int i) {
+        return bodyCells[static_cast<size_t>(id) * constants::ARENA_MAX_LENGTH + (bodyStart[id] + i) % constants::ARENA_MAX_LENGTH];
+    }
+    int randomEmptyCell();
+    void spawnSnake(int id);
+    void spawnApple();
+
+    void decide(size_t begin, size_t end);
+    void releaseTails(size_t begin, size_t end);
+    void claim(size_t begin, size_t end);
+    void resolve(size_t begin, size_t end);
+    void commit(size_t begin, size_t end);
+
+    SDL_Texture* texture = nullptr;
+    std::vector<uint32_t> pixels;
+};
@@ -0,0 +1,271 @@
+#include "assets.h"
+#include "resources.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <vector>
+
+namespace {
+    // 静态初始化在main之前，近似为进程启动的时刻
+    const auto launchTime = std::chrono::steady_clock::now();
+
+    double millisecondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+assets::AssetManager& assets::shared()
+{
+    static AssetManager manager;
+    return manager;
+}
+
+double assets::sinceLaunch()
+{
+    return millisecondsSince(launchTime);
+}
+
+std::string assets::AssetManager::pixelsKey(const uint8_t* pixels)
+{
+    char key[32];
+    std::snprintf(key, sizeof(key), "pixels:%p", static_cast<const void*>(pixels));
+    return key;
+}
+
+void assets::AssetManager::requestFont(const std::string& path, float size)
+{
+    fontFiles[path];
+    fonts[{ path, size }].pinned = true;
+}
+
+void assets::AssetManager::requestImage(const std::string& path)
+{
+    auto& image = images[path];
+    image.path = path;
+    image.pinned = true;
+}
+
+void assets::AssetManager::requestPixels(const uint8_t* pixels, int width, int height, int pitch)
+{
+    auto& image = images[pixelsKey(pixels)];
+    image.pixels = pixels;
+    image.width = width;
+    image.height = height;
+    image.pitch = pitch;
+    image.pinned = true;
+}
+
+void assets::AssetManager::startPreload(int threads)
+{
+    preloadStart = std::chrono::steady_clock::now();
+    preloadEndMicros = 0;
+
+    // 只有读文件和解码值得放到后台；内置像素在上传时直接包装成surface
+    std::vector<std::function<void()>> jobs;
+    for (auto& entry : fontFiles) {
+        if (entry.second.data) continue;
+        auto* path = &entry.first;
+        auto* file = &entry.second;
+        jobs.push_back([this, path, file] { loadFontFile(*path, *file); });
+    }
+    for (auto& entry : images) {
+        auto* image = &entry.second;
+        if (image->path.empty() || image->surface || image->texture) continue;
+        jobs.push_back([this, image] { decodeImage(*image); });
+    }
+    stats.fileReads += static_cast<int>(jobs.size());
+    if (jobs.empty()) return;
+
+    if (threads <= 0) threads = std::min<int>(static_cast<int>(jobs.size()), std::max(1u, std::thread::hardware_concurrency()));
+    pool.reset(new utils::ThreadPool(threads));
+    for (auto& job : jobs) {
+        pool->submit([this, job] {
+            job();
+            int64_t end = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - preloadStart).count();
+            int64_t previous = preloadEndMicros.load();
+            while (end > previous && !preloadEndMicros.compare_exchange_weak(previous, end)) {}
+        });
+    }
+}
+
+void assets::AssetManager::finishPreload(SDL_Renderer* renderer)
+{
+    auto start = std::chrono::steady_clock::now();
+    if (pool) {
+        pool->wait();
+        pool.reset();
+        stats.waitMs = millisecondsSince(start);
+        stats.preloadMs = preloadEndMicros.load() / 1000.0;
+    }
+
+    // TTF_RenderText只能在打开字体的线程上调用，所以字体在这里打开；文件内容已经在内存中
+    auto uploadStart = std::chrono::steady_clock::now();
+    for (auto& entry : fonts) {
+        // 读取失败的文件已经报过错，等acquire时再重试
+        if (entry.second.font || !fontFiles[entry.first.first].data) continue;
+        entry.second.font = openFont(entry.first.first, entry.first.second);
+    }
+    for (auto& entry : images) {
+        if (!entry.second.texture) upload(renderer, entry.second);
+    }
+    stats.uploadMs = millisecondsSince(uploadStart);
+}
+
+TTF_Font* assets::AssetManager::acquireFont(const std::string& path, float size)
+{
+    auto& font = fonts[{ path, size }];
+    if (!font.font) {
+        stats.misses++;
+        font.font = openFont(path, size);
+        if (!font.font) return nullptr;
+    }
+    font.refs++;
+    return font.font;
+}
+
+SDL_Texture* assets::AssetManager::acquireImage(SDL_Renderer* renderer, const std::string& path)
+{
+    auto& image = images[path];
+    if (!image.texture) {
+        stats.misses++;
+        image.path = path;
+        if (!image.surface) {
+            stats.fileReads++;
+            if (!decodeImage(image)) return nullptr;
+        }
+        if (!upload(renderer, image)) return nullptr;
+    }
+    image.refs++;
+    return image.texture;
+}
+
+SDL_Texture* assets::AssetManager::acquirePixels(SDL_Renderer* renderer, const uint8_t* pixels, int width, int height, int pitch)
+{
+    auto& image = images[pixelsKey(pixels)];
+    if (!image.texture) {
+        stats.misses++;
+        image.pixels = pixels;
+        image.width = width;
+        image.height = height;
+        image.pitch = pitch;
+        if (!upload(renderer, image)) return nullptr;
+    }
+    image.refs++;
+    return image.texture;
+}
+
+void assets::AssetManager::release(TTF_Font* font)
+{
+    if (!font) return;
+    for (auto it = fonts.begin(); it != fonts.end(); ++it) {
+        if (it->second.font != font) continue;
+        if (--it->second.refs <= 0 && !it->second.pinned) {
+            resources::closeFont(font);
+            stats.fonts--;
+            fonts.erase(it);
+        }
+        return;
+    }
+}
+
+void assets::AssetManager::release(SDL_Texture* texture)
+{
+    if (!texture) return;
+    for (auto it = images.begin(); it != images.end(); ++it) {
+        if (it->second.texture != texture) continue;
+        if (--it->second.refs <= 0 && !it->second.pinned) {
+            resources::destroyTexture(texture);
+            stats.textures--;
+            images.erase(it);
+        }
+        return;
+    }
+}
+
+void assets::AssetManager::clear()
+{
+    if (pool) {
+        pool->wait();
+        pool.reset();
+    }
+    for (auto& entry : fonts) {
+        if (entry.second.font) resources::closeFont(entry.second.font);
+    }
+    for (auto& entry : images) {
+        resources::destroySurface(entry.second.surface);
+        if (entry.second.texture) resources::destroyTexture(entry.second.texture);
+    }
+    // 字体对象引用着文件内容，最后释放
+    for (auto& entry : fontFiles) {
+        SDL_free(entry.second.data);
+    }
+    fonts.clear();
+    images.clear();
+    fontFiles.clear();
+    stats.fonts = 0;
+    stats.textures = 0;
+}
+
+bool assets::AssetManager::loadFontFile(const std::string& path, FontFile& file)
+{
+    file.data = SDL_LoadFile(path.c_str(), &file.size);
+    if (!file.data) {
+        std::cerr << "Failed to read font " << path << ": " << SDL_GetError() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool assets::AssetManager::decodeImage(Image& image)
+{
+    image.surface = resources::loadImage(image.path.c_str());
+    if (!image.surface) {
+        std::cerr << "Failed to load image " << image.path << ": " << SDL_GetError() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+TTF_Font* assets::AssetManager::openFont(const std::string& path, float size)
+{
+    auto& file = fontFiles[path];
+    if (!file.data) {
+        stats.fileReads++;
+        if (!loadFontFile(path, file)) return nullptr;
+    }
+    SDL_IOStream* stream = SDL_IOFromConstMem(file.data, file.size);
+    TTF_Font* font = stream ? resources::openFont(stream, true, size) : nullptr;
+    if (!font) {
+        std::cerr << "Failed to load font: " << SDL_GetError() << std::endl;
+        return nullptr;
+    }
+    stats.fonts++;
+    return font;
+}
+
+bool assets::AssetManager::upload(SDL_Renderer* renderer, Image& image)
+{
+    bool isPixels = image.path.empty();
+    if (!image.surface && isPixels) {
+        image.surface = resources::createSurfaceFrom(image.width, image.height, SDL_PIXELFORMAT_RGBA8888,
+            const_cast<uint8_t*>(image.pixels), image.pitch);
+    }
+    if (!image.surface) {
+        if (isPixels) std::cerr << "Failed to create surface: " << SDL_GetError() << std::endl;
+        return false;
+    }
+    image.texture = resources::createTextureFromSurface(renderer, image.surface);
+    resources::destroySurface(image.surface);
+    image.surface = nullptr;
+    if (!image.texture) {
+        std::cerr << "Failed to create texture: " << SDL_GetError() << std::endl;
+        return false;
+    }
+    // 像素精灵放大时保持清晰的方块
+    if (isPixels) SDL_SetTextureBlendMode(image.texture, SDL_BLENDMODE_NONE);
+    SDL_SetTextureScaleMode(image.texture, SDL_SCALEMODE_NEAREST);
+    stats.textures++;
+    return true;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+// 字体和图片的统一管理：同一个资源只加载一次，按引用计数释放。
+// 启动时先登记要用的资源，在工作线程上并行读取字体文件、解码图片，同时主线程初始化SDL和窗口；
+// 之后在渲染线程上打开字体，并把所有图片一次性上传成纹理。
+
+#include "thread_pool.h"
+
+#include <SDL3/SDL.h>
+#include <SDL3_ttf/SDL_ttf.h>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+
+namespace assets {
+    constexpr const char* DEFAULT_FONT = "./assets/VonwaonBitmap-16px.ttf";
+
+    class AssetManager;
+    // 界面代码共用的实例
+    AssetManager& shared();
+    // 从进程启动到现在的毫秒数
+    double sinceLaunch();
+}
+
+class assets::AssetManager {
+public:
+    struct Stats {
+        int fonts = 0;         // 已打开的字体（字体文件+字号）
+        int textures = 0;      // 已上传的纹理
+        int fileReads = 0;     // 读取字体文件和图片文件的次数
+        int misses = 0;        // 没有预加载、在acquire时同步加载的次数
+        double preloadMs = 0;  // 从startPreload到后台任务全部完成
+        double waitMs = 0;     // finishPreload中等待后台任务的时间
+        double uploadMs = 0;   // 在渲染线程上打开字体和上传纹理的时间
+    };
+
+    ~AssetManager() { clear(); }
+
+    // 登记启动时要用的资源。登记过的资源由管理器自己持有一个引用，直到clear()
+    void requestFont(const std::string& path, float size);
+    void requestImage(const std::string& path);
+    // 内置的像素精灵（RGBA8888），以像素数组的地址区分
+    void requestPixels(const uint8_t* pixels, int width, int height, int pitch);
+
+    // 在后台线程上读取和解码已登记的资源，立即返回
+    void startPreload(int threads = 0);
+    // 等待后台任务完成，然后在调用线程（渲染线程）上打开字体、批量上传纹理。
+    // startPreload和finishPreload之间不能调用acquire
+    void finishPreload(SDL_Renderer* renderer);
+
+    // 引用计数加一，没有加载过的资源当场同步加载。失败返回nullptr
+    TTF_Font* acquireFont(const std::string& path, float size);
+    SDL_Texture* acquireImage(SDL_Renderer* renderer, const std::string& path);
+    SDL_Texture* acquirePixels(SDL_Renderer* renderer, const uint8_t* pixels, int width, int height, int pitch);
+    // 引用计数减一，为0时释放。不认识的指针直接忽略
+    void release(TTF_Font* font);
+    void release(SDL_Texture* texture);
+
+    // 释放全部资源，须在销毁渲染器和TTF_Quit之前调用
+    void clear();
+
+    const Stats& getStats() const { return stats; }
+
+private:
+    // 字体文件的内容，同一文件的不同字号共用
+    struct FontFile {
+        void* data = nullptr;
+        size_t size = 0;
+    };
+    struct Font {
+        TTF_Font* font = nullptr;
+        int refs = 0;
+        bool pinned = false; // 登记过，引用计数为0也不释放
+    };
+    struct Image {
+        std::string path;              // 为空表示内置像素
+        const uint8_t* pixels = nullptr;
+        int width = 0, height = 0, pitch = 0;
+        SDL_Surface* surface = nullptr; // 解码好、还没有上传的图片
+        SDL_Texture* texture = nullptr;
+        int refs = 0;
+        bool pinned = false;
+    };
+
+    std::map<std::string, FontFile> fontFiles;
+    std::map<std::pair<std::string, float>, Font> fonts;
+    std::map<std::string, Image> images; // 图片按路径，内置像素按地址
+    std::unique_ptr<utils::ThreadPool> pool;
+    std::chrono::steady_clock::time_point preloadStart;
+    std::atomic<int64_t> preloadEndMicros{0}; // 最后一个后台任务完成的时刻，相对preloadStart
+    Stats stats;
+
+    static std::string pixelsKey(const uint8_t* pixels);
+    bool loadFontFile(const std::string& path, FontFile& file);
+    bool decodeImage(Image& image);
+    TTF_Font* openFont(const std::string& path, float size);
+    bool upload(SDL_Renderer* renderer, Image& image);
+};
@@ -0,0 +1,168 @@
+#include "audio.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+namespace {
+    constexpr float PI = 3.14159265f;
+
+    const char* SOUND_FILES[audio::SOUND_COUNT] = {
+        "./assets/sfx/eat.wav",
+        "./assets/sfx/turn.wav",
+        "./assets/sfx/speedup.wav",
+        "./assets/sfx/gameover.wav",
+    };
+
+    // 频率从freqStart线性滑到freqEnd的一段音，带线性衰减包络
+    void appendTone(std::vector<float>& out, float seconds, float freqStart, float freqEnd, float volume) {
+        int frames = static_cast<int>(seconds * audio::SAMPLE_RATE);
+        float phase = 0.0f;
+        for (int i = 0; i < frames; i++) {
+            float t = static_cast<float>(i) / frames;
+            float freq = freqStart + (freqEnd - freqStart) * t;
+            phase += 2 * PI * freq / audio::SAMPLE_RATE;
+            float value = std::sin(phase) * volume * (1.0f - t);
+            for (int c = 0; c < audio::CHANNELS; c++) {
+                out.push_back(value);
+            }
+        }
+    }
+}
+
+bool audio::AudioEngine::init()
+{
+    if (!SDL_InitSubSystem(SDL_INIT_AUDIO)) {
+        std::cerr << "Failed to init audio: " << SDL_GetError() << std::endl;
+        return false;
+    }
+
+    // 先把所有音效解码到内存，音频线程开始后sounds就不再修改
+    for (int i = 0; i < SOUND_COUNT; i++) {
+        if (!loadSound(static_cast<Sound>(i), SOUND_FILES[i])) {
+            synthesize(static_cast<Sound>(i));
+        }
+    }
+
+    // 设备缓冲越小，从触发到出声的延迟越低
+    SDL_SetHint(SDL_HINT_AUDIO_DEVICE_SAMPLE_FRAMES, std::to_string(MIX_FRAMES).c_str());
+
+    SDL_AudioSpec spec = { SDL_AUDIO_F32, CHANNELS, SAMPLE_RATE };
+    stream = SDL_OpenAudioDeviceStream(SDL_AUDIO_DEVICE_DEFAULT_PLAYBACK, &spec, audioCallback, this);
+    if (!stream) {
+        std::cerr << "Failed to open audio device: " << SDL_GetError() << std::endl;
+        SDL_QuitSubSystem(SDL_INIT_AUDIO);
+        return false;
+    }
+    SDL_ResumeAudioStreamDevice(stream);
+    std::cout << "Audio initialized." << std::endl;
+    return true;
+}
+
+void audio::AudioEngine::shutdown()
+{
+    if (!stream) return;
+    SDL_DestroyAudioStream(stream);
+    stream = nullptr;
+    SDL_QuitSubSystem(SDL_INIT_AUDIO);
+}
+
+bool audio::AudioEngine::loadSound(Sound sound, const char* path)
+{
+    SDL_AudioSpec srcSpec;
+    Uint8* srcData = nullptr;
+    Uint32 srcLength = 0;
+    if (!SDL_LoadWAV(path, &srcSpec, &srcData, &srcLength)) {
+        return false;
+    }
+
+    SDL_AudioSpec dstSpec = { SDL_AUDIO_F32, CHANNELS, SAMPLE_RATE };
+    Uint8* dstData = nullptr;
+    int dstLength = 0;
+    bool ok = SDL_ConvertAudioSamples(&srcSpec, srcData, srcLength, &dstSpec, &dstData, &dstLength);
+    SDL_free(srcData);
+    if (!ok) {
+        std::cerr << "Failed to convert " << path << ": " << SDL_GetError() << std::endl;
+        return false;
+    }
+
+    auto samples = reinterpret_cast<float*>(dstData);
+    sounds[sound].assign(samples, samples + dstLength / sizeof(float));
+    SDL_free(dstData);
+    return true;
+}
+
+// 没有音效文件时用程序生成的音效代替
+void audio::AudioEngine::synthesize(Sound sound)
+{
+    auto& out = sounds[sound];
+    out.clear();
+    switch (sound)
+    {
+    case EAT:
+        appendTone(out, 0.07f, 660.0f, 1320.0f, 0.5f);
+        break;
+    case TURN:
+        appendTone(out, 0.012f, 1800.0f, 1800.0f, 0.15f);
+        break;
+    case SPEED_UP:
+        appendTone(out, 0.05f, 523.0f, 523.0f, 0.4f);
+        appendTone(out, 0.05f, 659.0f, 659.0f, 0.4f);
+        appendTone(out, 0.08f, 784.0f, 784.0f, 0.4f);
+        break;
+    case GAME_OVER:
+        appendTone(out, 0.6f, 440.0f, 110.0f, 0.6f);
+        break;
+    default:
+        break;
+    }
+}
+
+// 在音频线程调用
+void audio::AudioEngine::mix(float* out, int frames)
+{
+    Command command;
+    while (commands.pop(command)) {
+        // 优先用空闲的voice，否则替换播放得最久的那个
+        Voice* target = &voices[0];
+        for (auto& voice : voices) {
+            if (!voice.samples) {
+                target = &voice;
+                break;
+            }
+            if (voice.position > target->position) target = &voice;
+        }
+        target->samples = &sounds[command.sound];
+        target->position = 0;
+        target->volume = command.volume;
+    }
+
+    int count = frames * CHANNELS;
+    std::fill(out, out + count, 0.0f);
+    for (auto& voice : voices) {
+        if (!voice.samples) continue;
+        const auto& samples = *voice.samples;
+        size_t n = std::min(static_cast<size_t>(count), samples.size() - voice.position);
+        for (size_t i = 0; i < n; i++) {
+            out[i] += samples[voice.position + i] * voice.volume;
+        }
+        voice.position += n;
+        if (voice.position >= samples.size()) voice.samples = nullptr;
+    }
+    for (int i = 0; i < count; i++) {
+        out[i] = std::fmax(-1.0f, std::fmin(1.0f, out[i]));
+    }
+}
+
+void SDLCALL audio::AudioEngine::audioCallback(void* userdata, SDL_AudioStream* stream, int additional_amount, int /*total_amount*/)
+{
+    auto engine = static_cast<AudioEngine*>(userdata);
+    int frames = additional_amount / static_cast<int>(CHANNELS * sizeof(float));
+    while (frames > 0) {
+        int n = std::min(frames, MIX_FRAMES);
+        engine->mix(engine->mixBuffer.data(), n);
+        SDL_PutAudioStreamData(stream, engine->mixBuffer.data(), n * CHANNELS * sizeof(float));
+        frames -= n;
+    }
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <SDL3/SDL.h>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+namespace audio {
+    enum Sound { EAT, TURN, SPEED_UP, GAME_OVER, SOUND_COUNT };
+
+    constexpr int SAMPLE_RATE = 48000;
+    constexpr int CHANNELS = 2;
+    constexpr int MIX_FRAMES = 256; // 每次混音的帧数，约5毫秒
+    constexpr int MAX_VOICES = 8;   // 同时播放的音效数量
+
+    template <typename T, size_t N> class SpscQueue;
+    class AudioEngine;
+}
+
+// 单生产者单消费者的无锁队列：游戏线程push，音频回调pop。
+template <typename T, size_t N>
+class audio::SpscQueue {
+    static_assert((N & (N - 1)) == 0, "capacity must be a power of two");
+public:
+    // 队列满时返回false，调用方直接丢弃这条命令
+    bool push(const T& value) {
+        auto tail = this->tail.load(std::memory_order_relaxed);
+        if (tail - head.load(std::memory_order_acquire) == N) {
+            return false;
+        }
+        buffer[tail & (N - 1)] = value;
+        this->tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+    bool pop(T& value) {
+        auto head = this->head.load(std::memory_order_relaxed);
+        if (head == tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = buffer[head & (N - 1)];
+        this->head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+private:
+    std::array<T, N> buffer;
+    alignas(64) std::atomic<uint32_t> head{0};
+    alignas(64) std::atomic<uint32_t> tail{0};
+};
+
+// 启动时把所有音效解码成内存中的float PCM，播放时只向队列发一条命令，
+// 混音在SDL的音频线程里完成，不会阻塞Round::update()。
+class audio::AudioEngine {
+public:
+    AudioEngine() {}
+    ~AudioEngine() {
+        shutdown();
+    }
+    bool init();
+    void shutdown();
+
+    // 可在游戏线程任意调用，不加锁也不分配内存
+    void play(Sound sound, float volume = 1.0f) {
+        if (!stream) return;
+        if (!commands.push(Command{ static_cast<uint8_t>(sound), volume })) {
+            droppedCommands.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    uint32_t getDroppedCommands() const {
+        return droppedCommands.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct Command {
+        uint8_t sound;
+        float volume;
+    };
+    struct Voice {
+        const std::vector<float>* samples = nullptr;
+        size_t position = 0;
+        float volume = 1.0f;
+    };
+
+    SDL_AudioStream* stream = nullptr;
+    std::array<std::vector<float>, SOUND_COUNT> sounds; // 交错的立体声样本
+    SpscQueue<Command, 64> commands;
+    std::atomic<uint32_t> droppedCommands{0};
+
+    // 以下只在音频线程访问
+    std::array<Voice, MAX_VOICES> voices;
+    std::array<float, MIX_FRAMES * CHANNELS> mixBuffer;
+
+    bool loadSound(Sound sound, const char* path);
+    void synthesize(Sound sound);
+    void mix(float* out, int frames);
+    static void SDLCALL audioCallback(void* userdata, SDL_AudioStream* stream, int additional_amount, int total_amount);
+};
@@ -0,0 +1,103 @@
+// SpeedSnakeBot [--strategy greedy|random] [--delay-us N]
+// 示例AI，也是外部AI的参考实现：由SpeedSnakeTournament启动，每收到一个MSG_MOVE_REQUEST回复一个方向。
+// --delay-us让每步故意多想一会儿，用来测试时间预算。
+
+#include "bot_protocol.h"
+#include "protocol.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+
+namespace {
+    // 下标与snake::Direction相同：NORTH, WEST, SOUTH, EAST
+    const int dx[4] = { 0, -1, 0, 1 };
+    const int dy[4] = { -1, 0, 1, 0 };
+
+    uint8_t chooseMove(const uint8_t* request, size_t size, bool greedy, std::mt19937& rng) {
+        int width = net::readLE<uint16_t>(request + 10);
+        int height = net::readLE<uint16_t>(request + 12);
+        int headX = net::readLE<int16_t>(request + 14);
+        int headY = net::readLE<int16_t>(request + 16);
+        uint8_t current = request[18];
+        const uint8_t* cells = request + bot::MOVE_REQUEST_HEADER;
+        if (size < bot::MOVE_REQUEST_HEADER + static_cast<size_t>(width) * height) return current;
+
+        int best = -1, bestDistance = 1 << 30;
+        int ties = 0;
+        for (int d = 0; d < 4; d++) {
+            if ((d + 2) % 4 == current) continue;
+            int x = headX + dx[d], y = headY + dy[d];
+            if (x < 0 || y < 0 || x >= width || y >= height) continue;
+            uint8_t cell = cells[y * width + x];
+            if (cell == 1 || cell == 3) continue;
+
+            int distance = 0;
+            if (greedy) {
+                distance = 1 << 30;
+                for (int i = 0; i < width * height; i++) {
+                    if (cells[i] != 2) continue;
+                    distance = std::min(distance, std::abs(i % width - x) + std::abs(i / width - y));
+                }
+            }
+            // 距离相同的方向随机选一个
+            if (distance < bestDistance) {
+                best = d;
+                bestDistance = distance;
+                ties = 1;
+            }
+            else if (distance == bestDistance && rng() % ++ties == 0) {
+                best = d;
+            }
+        }
+        return best < 0 ? current : static_cast<uint8_t>(best);
+    }
+}
+
+int main(int argc, char* argv[]){
+    bool greedy = true;
+    long delayUs = 0;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        if (option == "--strategy") greedy = std::string(argv[i + 1]) != "random";
+        else if (option == "--delay-us") delayUs = std::atol(argv[i + 1]);
+    }
+
+    auto channel = bot::connectFromEnvironment();
+    std::mt19937 rng(std::random_device{}());
+    uint8_t buffer[bot::MAX_MESSAGE];
+    uint8_t reply[6];
+    while (true) {
+        long size = channel->receive(buffer, sizeof(buffer), -1);
+        if (size < 0) return 0;
+        if (size == 0) continue;
+
+        switch (buffer[0])
+        {
+        case bot::MSG_PING:
+            if (size < 5) break;
+            reply[0] = bot::MSG_PONG;
+            std::copy(buffer + 1, buffer + 5, reply + 1);
+            channel->send(reply, 5);
+            break;
+
+        case bot::MSG_MOVE_REQUEST:
+            if (size < static_cast<long>(bot::MOVE_REQUEST_HEADER)) break;
+            reply[0] = bot::MSG_MOVE;
+            std::copy(buffer + 1, buffer + 5, reply + 1);
+            reply[5] = chooseMove(buffer, size, greedy, rng);
+            if (delayUs > 0) std::this_thread::sleep_for(std::chrono::microseconds(delayUs));
+            channel->send(reply, 6);
+            break;
+
+        case bot::MSG_QUIT:
+            return 0;
+
+        default:
+            break;
+        }
+    }
+}
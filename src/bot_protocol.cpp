@@ -0,0 +1,306 @@
+#include "bot_protocol.h"
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+
+extern char** environ;
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    void futexWait(std::atomic<uint32_t>* address, uint32_t expected, long timeoutUs) {
+        timespec timeout;
+        timeout.tv_sec = timeoutUs / 1000000;
+        timeout.tv_nsec = (timeoutUs % 1000000) * 1000;
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(address), FUTEX_WAIT, expected,
+            timeoutUs >= 0 ? &timeout : nullptr, nullptr, 0);
+    }
+
+    void futexWake(std::atomic<uint32_t>* address) {
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(address), FUTEX_WAKE, 1, nullptr, nullptr, 0);
+    }
+
+    void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+
+    // 单核时自旋只会占住对方需要的CPU
+    const int SPIN_LIMIT = std::thread::hardware_concurrency() > 1 ? 4000 : 0;
+
+    long remainingUs(Clock::time_point deadline) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(deadline - Clock::now()).count();
+    }
+}
+
+bool bot::ShmRing::push(const uint8_t* data, size_t size)
+{
+    uint32_t position = head.load(std::memory_order_relaxed);
+    if (size > MAX_MESSAGE || position - tail.load(std::memory_order_acquire) >= SLOTS) {
+        return false;
+    }
+    auto& slot = slots[position % SLOTS];
+    slot.size = static_cast<uint32_t>(size);
+    std::memcpy(slot.data, data, size);
+    head.store(position + 1, std::memory_order_seq_cst);
+    if (waiting.load(std::memory_order_seq_cst)) {
+        futexWake(&head);
+    }
+    return true;
+}
+
+size_t bot::ShmRing::pop(uint8_t* buffer, size_t capacity, long timeoutUs)
+{
+    auto deadline = Clock::now() + std::chrono::microseconds(timeoutUs);
+    uint32_t position = tail.load(std::memory_order_relaxed);
+    int spins = SPIN_LIMIT;
+    while (true) {
+        if (head.load(std::memory_order_acquire) != position) {
+            auto& slot = slots[position % SLOTS];
+            size_t size = std::min<size_t>(slot.size, capacity);
+            std::memcpy(buffer, slot.data, size);
+            tail.store(position + 1, std::memory_order_release);
+            return size;
+        }
+        // 先自旋一小会儿，对方通常在几微秒内就会回复
+        if (spins > 0) {
+            spins--;
+            cpuRelax();
+            continue;
+        }
+
+        long remaining = -1;
+        if (timeoutUs >= 0) {
+            remaining = remainingUs(deadline);
+            if (remaining <= 0) return 0;
+        }
+        waiting.store(1, std::memory_order_seq_cst);
+        // 设置waiting之后再检查一次，避免错过唤醒；head变了futex也会立即返回
+        if (head.load(std::memory_order_seq_cst) == position) {
+            futexWait(&head, position, remaining);
+        }
+        waiting.store(0, std::memory_order_relaxed);
+    }
+}
+
+bot::ShmChannel::ShmChannel(int fd, bool isBot)
+{
+    void* address = mmap(nullptr, sizeof(SharedRegion), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED) {
+        std::cerr << "mmap shared region failed: " << strerror(errno) << std::endl;
+        return;
+    }
+    region = static_cast<SharedRegion*>(address);
+    outgoing = isBot ? &region->fromBot : &region->toBot;
+    incoming = isBot ? &region->toBot : &region->fromBot;
+}
+
+bot::ShmChannel::~ShmChannel()
+{
+    if (region) munmap(region, sizeof(SharedRegion));
+}
+
+bool bot::ShmChannel::send(const uint8_t* data, size_t size)
+{
+    return region && outgoing->push(data, size);
+}
+
+long bot::ShmChannel::receive(uint8_t* buffer, size_t capacity, long timeoutUs)
+{
+    if (!region) return -1;
+    return static_cast<long>(incoming->pop(buffer, capacity, timeoutUs));
+}
+
+bot::PipeChannel::~PipeChannel()
+{
+    // 标准输入输出不归这个对象管
+    if (readFd > 2) close(readFd);
+    if (writeFd > 2) close(writeFd);
+}
+
+bool bot::PipeChannel::send(const uint8_t* data, size_t size)
+{
+    frame.resize(4 + size);
+    for (int i = 0; i < 4; i++) frame[i] = static_cast<uint8_t>(size >> (i * 8));
+    std::memcpy(frame.data() + 4, data, size);
+    size_t written = 0;
+    while (written < frame.size()) {
+        ssize_t n = write(writeFd, frame.data() + written, frame.size() - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        written += n;
+    }
+    return true;
+}
+
+long bot::PipeChannel::receive(uint8_t* buffer, size_t capacity, long timeoutUs)
+{
+    auto deadline = Clock::now() + std::chrono::microseconds(timeoutUs);
+    uint8_t chunk[4096];
+    while (true) {
+        if (pending.size() >= 4) {
+            size_t size = pending[0] | (pending[1] << 8) | (pending[2] << 16) | (static_cast<size_t>(pending[3]) << 24);
+            // 长度来自对方进程，不可信；超长的消息当作对方出错，不再继续缓存
+            if (size > MAX_MESSAGE) return -1;
+            if (pending.size() >= 4 + size) {
+                size_t copied = std::min(size, capacity);
+                std::memcpy(buffer, pending.data() + 4, copied);
+                pending.erase(pending.begin(), pending.begin() + 4 + size);
+                return static_cast<long>(copied);
+            }
+        }
+
+        pollfd descriptor = { readFd, POLLIN, 0 };
+        timespec timeout;
+        timespec* timeoutPointer = nullptr;
+        if (timeoutUs >= 0) {
+            long remaining = remainingUs(deadline);
+            if (remaining <= 0) return 0;
+            timeout.tv_sec = remaining / 1000000;
+            timeout.tv_nsec = (remaining % 1000000) * 1000;
+            timeoutPointer = &timeout;
+        }
+        int ready = ppoll(&descriptor, 1, timeoutPointer, nullptr);
+        if (ready < 0 && errno == EINTR) continue;
+        if (ready < 0) return -1;
+        if (ready == 0) return 0;
+
+        ssize_t n = read(readFd, chunk, sizeof(chunk));
+        if (n < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+        if (n <= 0) return -1;
+        pending.insert(pending.end(), chunk, chunk + n);
+    }
+}
+
+std::unique_ptr<bot::Channel> bot::connectFromEnvironment()
+{
+    const char* value = getenv(SHM_ENV);
+    if (value) {
+        std::unique_ptr<ShmChannel> channel(new ShmChannel(std::atoi(value), true));
+        if (channel->isValid()) return channel;
+    }
+    return std::unique_ptr<Channel>(new PipeChannel(0, 1));
+}
+
+bot::BotProcess::~BotProcess()
+{
+    stop();
+}
+
+bool bot::BotProcess::start(const std::string& command, bool usePipe)
+{
+    // fork之后的子进程只能调用异步信号安全的函数，所以参数和环境变量都先准备好
+    int toBot[2] = { -1, -1 }, fromBot[2] = { -1, -1 };
+    int shmFd = -1;
+    // 失败时关闭已经打开的描述符
+    auto closeAll = [&] {
+        for (int fd : { toBot[0], toBot[1], fromBot[0], fromBot[1], shmFd }) {
+            if (fd >= 0) close(fd);
+        }
+    };
+    if (usePipe) {
+        if (pipe2(toBot, O_CLOEXEC) < 0 || pipe2(fromBot, O_CLOEXEC) < 0) {
+            std::cerr << "pipe failed: " << strerror(errno) << std::endl;
+            closeAll();
+            return false;
+        }
+    }
+    else {
+        shmFd = memfd_create("snake-bot", MFD_CLOEXEC);
+        if (shmFd < 0 || ftruncate(shmFd, sizeof(SharedRegion)) < 0) {
+            std::cerr << "memfd failed: " << strerror(errno) << std::endl;
+            closeAll();
+            return false;
+        }
+    }
+
+    std::string script = "exec " + command;
+    std::string shmVariable = std::string(SHM_ENV) + "=" + std::to_string(shmFd);
+    std::vector<char*> environment;
+    for (char** variable = environ; *variable; variable++) {
+        if (std::strncmp(*variable, SHM_ENV, std::strlen(SHM_ENV)) != 0) environment.push_back(*variable);
+    }
+    if (shmFd >= 0) environment.push_back(&shmVariable[0]);
+    environment.push_back(nullptr);
+    char* arguments[] = { const_cast<char*>("sh"), const_cast<char*>("-c"), &script[0], nullptr };
+
+    pid = fork();
+    if (pid < 0) {
+        std::cerr << "fork failed: " << strerror(errno) << std::endl;
+        closeAll();
+        return false;
+    }
+    if (pid == 0) {
+        // 比赛程序退出时AI也退出
+        prctl(PR_SET_PDEATHSIG, SIGTERM);
+        if (usePipe) {
+            dup2(toBot[0], 0);
+            dup2(fromBot[1], 1);
+        }
+        else {
+            fcntl(shmFd, F_SETFD, 0);
+        }
+        execve("/bin/sh", arguments, environment.data());
+        _exit(127);
+    }
+
+    if (usePipe) {
+        close(toBot[0]);
+        close(fromBot[1]);
+        link.reset(new PipeChannel(fromBot[0], toBot[1]));
+    }
+    else {
+        std::unique_ptr<ShmChannel> channel(new ShmChannel(shmFd, false));
+        close(shmFd);
+        if (!channel->isValid()) {
+            stop();
+            return false;
+        }
+        link = std::move(channel);
+    }
+    return true;
+}
+
+bool bot::BotProcess::isRunning()
+{
+    if (pid <= 0) return false;
+    int status;
+    if (waitpid(pid, &status, WNOHANG) == pid) {
+        pid = -1;
+        return false;
+    }
+    return true;
+}
+
+void bot::BotProcess::stop()
+{
+    if (pid > 0) {
+        if (link) {
+            uint8_t quit = MSG_QUIT;
+            link->send(&quit, 1);
+        }
+        // 给AI一点时间自己退出
+        for (int i = 0; i < 20 && isRunning(); i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        if (pid > 0) {
+            kill(pid, SIGKILL);
+            waitpid(pid, nullptr, 0);
+            pid = -1;
+        }
+    }
+    link.reset();
+}
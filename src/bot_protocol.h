@@ -0,0 +1,125 @@
+#pragma once
+
+// 外部AI（独立进程）与比赛程序之间的通信。默认使用共享内存环形缓冲，
+// 有数据时用futex唤醒对方；--pipe时退回到标准输入输出管道。仅支持Linux。
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+namespace bot {
+    // 消息的第一个字节是类型，之后的整数都按小端存储。
+    // MSG_MOVE_REQUEST末尾是宽*高个字节的地图，按行排列（下标 y * 宽 + x，y向下增大），不含四周的墙，
+    // 每格：0 空，1 蛇身或关卡里的墙，2 苹果，3 蛇头（包括对手的）。
+    // 方向取值：0 上，1 左，2 下，3 右；不能掉头，回复与当前方向相反时忽略。
+    enum MessageType : uint8_t {
+        // 比赛程序 -> AI
+        MSG_MOVE_REQUEST = 1, // u32 请求序号, u32 tick, u8 玩家, u16 宽, u16 高, i16 蛇头x, i16 蛇头y, u8 方向, 每格一个字节
+        MSG_PING = 2,         // u32 序号
+        MSG_QUIT = 3,
+        // AI -> 比赛程序
+        MSG_MOVE = 0x81,      // u32 请求序号（原样返回）, u8 方向
+        MSG_PONG = 0x82,      // u32 序号
+    };
+
+    constexpr size_t MAX_MESSAGE = 16384;
+    constexpr size_t MOVE_REQUEST_HEADER = 1 + 4 + 4 + 1 + 2 + 2 + 2 + 2 + 1;
+    // AI进程从这个环境变量得到共享内存的文件描述符，没有时使用管道
+    constexpr const char* SHM_ENV = "SNAKE_BOT_SHM";
+
+    struct ShmRing;
+    struct SharedRegion;
+    class Channel;
+    class ShmChannel;
+    class PipeChannel;
+    class BotProcess;
+
+    // AI进程调用：按环境变量连接到比赛程序
+    std::unique_ptr<Channel> connectFromEnvironment();
+}
+
+// 单生产者单消费者的消息环。消费者没有数据时在head上futex等待，
+// 生产者看到waiting不为0才发起唤醒的系统调用。
+struct bot::ShmRing {
+    static constexpr uint32_t SLOTS = 8;
+
+    alignas(64) std::atomic<uint32_t> head;    // 生产者写入的消息数
+    alignas(64) std::atomic<uint32_t> tail;    // 消费者取走的消息数
+    std::atomic<uint32_t> waiting;
+    struct Slot {
+        uint32_t size;
+        uint8_t data[MAX_MESSAGE];
+    } slots[SLOTS];
+
+    bool push(const uint8_t* data, size_t size);
+    // 超时返回0；timeoutUs < 0 表示一直等待
+    size_t pop(uint8_t* buffer, size_t capacity, long timeoutUs);
+};
+
+struct bot::SharedRegion {
+    ShmRing toBot;
+    ShmRing fromBot;
+};
+
+// 可靠、保序的消息通道
+class bot::Channel {
+public:
+    virtual ~Channel() {}
+    virtual bool send(const uint8_t* data, size_t size) = 0;
+    // 返回消息长度，超时返回0，对方关闭返回-1。timeoutUs < 0 表示一直等待
+    virtual long receive(uint8_t* buffer, size_t capacity, long timeoutUs) = 0;
+};
+
+class bot::ShmChannel : public Channel {
+public:
+    // fd为memfd，isBot决定哪个环是发送方向
+    ShmChannel(int fd, bool isBot);
+    ~ShmChannel();
+    bool isValid() const { return region != nullptr; }
+
+    bool send(const uint8_t* data, size_t size) override;
+    long receive(uint8_t* buffer, size_t capacity, long timeoutUs) override;
+
+private:
+    SharedRegion* region = nullptr;
+    ShmRing* outgoing = nullptr;
+    ShmRing* incoming = nullptr;
+};
+
+// 每条消息前加u32长度
+class bot::PipeChannel : public Channel {
+public:
+    PipeChannel(int readFd, int writeFd) : readFd(readFd), writeFd(writeFd) {}
+    ~PipeChannel();
+
+    bool send(const uint8_t* data, size_t size) override;
+    long receive(uint8_t* buffer, size_t capacity, long timeoutUs) override;
+
+private:
+    int readFd, writeFd;
+    std::vector<uint8_t> pending; // 已读到但还不是完整消息的字节
+    std::vector<uint8_t> frame;
+};
+
+// 启动并管理一个AI进程
+class bot::BotProcess {
+public:
+    ~BotProcess();
+
+    // command交给/bin/sh执行，可以带参数
+    bool start(const std::string& command, bool usePipe);
+    void stop();
+    bool isRunning();
+    Channel& channel() { return *link; }
+    // 进程跨对局复用，序号在整个进程生命期内不重复，超时后才到的回复不会被当成之后请求的回复
+    uint32_t nextSequence() { return ++sequence; }
+
+private:
+    pid_t pid = -1;
+    uint32_t sequence = 0;
+    std::unique_ptr<Channel> link;
+};
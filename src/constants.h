@@ -29,6 +29,36 @@ namespace constants {
     constexpr int FPS = 60;
     constexpr float FRAME_TIME = 1000.0f / FPS;
 
+    // 速度：普通模式每5分加速一次，到NORMAL_MAX_TPS为止；高速模式之后每个苹果再加速约10%，到MAX_TPS为止。
+    // 快照、回放记录和数据集中TPS只占一个字节
+    constexpr int NORMAL_MAX_TPS = 20;
+    constexpr int MAX_TPS = 250;
+    constexpr int MAX_CATCHUP_MS = 100; // 落后超过这么久（卡顿、拖动窗口）时不再补tick
+    constexpr int INPUT_QUEUE_LIMIT = 4; // 每个玩家最多排队的输入
+    constexpr Uint8 SWEEP_ALPHA = 96; // 一帧推进多个tick时，这一帧里蛇尾扫过的格子的透明度
+
+    // 同一局最多的蛇数，被困标记每条蛇占一位
+    constexpr int MAX_PLAYERS = 8;
+
+    // 苹果优先生成在蛇头能到达的格子，随机这么多次都不行时退回到任意空格子
+    constexpr int REACHABLE_SPAWN_TRIES = 64;
+    // 蛇的随机出生位置最多尝试这么多次，之后从左上角顺序查找
+    constexpr int SPAWN_TRIES = 1024;
+
+    // 竞技场模式
+    constexpr int ARENA_TPS = 20;
+    constexpr int ARENA_DEFAULT_SNAKES = 10000;
+    constexpr int ARENA_CELLS_PER_SNAKE = 100; // 决定地图大小
+    constexpr int ARENA_MAX_LENGTH = 64;
+    constexpr int ARENA_INIT_LENGTH = 3;
+    constexpr int ARENA_RESPAWN_TICKS = 40;
+
+    // 观战墙
+    constexpr int SPECTATOR_DEFAULT_BOARDS = 64;
+    constexpr int SPECTATOR_WINDOW_WIDTH = 1280;
+    constexpr int SPECTATOR_WINDOW_HEIGHT = 960;
+    constexpr int SPECTATOR_RESTART_FRAMES = 120; // 一局结束后停留这么多帧再重新开始
+
     constexpr SDL_Color color_bg = {16, 0, 32, 255}, color_gridbg = {32, 0, 32, 255},
         color_gridline = {32, 32, 32, 255}, color_frame = {188, 188, 188, 255},
         color_bt_frame = {255, 0, 0, 255}, color_bt_text = {255, 255, 255, 255};
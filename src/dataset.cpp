@@ -0,0 +1,503 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "dataset.h"
+#include "utils.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    const char MAGIC[8] = { 'S', 'S', 'T', 'R', 'A', 'J', '0', '1' };
+    constexpr uint32_t VERSION = 1;
+    constexpr size_t HEADER_SIZE = 16;   // magic, u32 版本, u32 列数
+    constexpr size_t TRAILER_SIZE = 24;  // u64 目录位置, u32 chunk数, u32 列数, magic
+    constexpr size_t CHUNK_ENTRY_SIZE = 8 + 4 + dataset::COLUMN_COUNT * (8 + 4 + 1);
+
+    template <typename T>
+    void put(std::vector<uint8_t>& out, T value) {
+        for (size_t i = 0; i < sizeof(T); i++) out.push_back(static_cast<uint8_t>(static_cast<uint64_t>(value) >> (i * 8)));
+    }
+    template <typename T>
+    T get(const uint8_t* p) {
+        uint64_t value = 0;
+        for (size_t i = 0; i < sizeof(T); i++) value |= static_cast<uint64_t>(p[i]) << (i * 8);
+        return static_cast<T>(value);
+    }
+
+    void putVarint(std::vector<uint8_t>& out, uint32_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<uint8_t>(value));
+    }
+    bool getVarint(const uint8_t*& p, const uint8_t* end, uint32_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            if (p >= end) return false;
+            uint8_t byte = *p++;
+            value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+
+    uint32_t zigzag(int32_t value) {
+        return (static_cast<uint32_t>(value) << 1) ^ static_cast<uint32_t>(value >> 31);
+    }
+    int32_t unzigzag(uint32_t value) {
+        return static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+    }
+}
+
+const char* dataset::columnName(Column column)
+{
+    static const char* names[COLUMN_COUNT] = {
+        "episode", "tick", "head_x", "head_y", "direction", "action", "reward", "score", "tps",
+        "apple0_x", "apple0_y", "apple1_x", "apple1_y", "apple2_x", "apple2_y",
+    };
+    return column < COLUMN_COUNT ? names[column] : "?";
+}
+
+dataset::Step dataset::makeStep(snake::Round& round, uint32_t episode, uint8_t action, int8_t reward)
+{
+    Step step;
+    step.episode = episode;
+    step.tick = round.getTick();
+    auto snake = round.getSnake(0);
+    step.headX = static_cast<int16_t>(snake->head->x);
+    step.headY = static_cast<int16_t>(snake->head->y);
+    step.direction = static_cast<uint8_t>(snake->head->direction);
+    step.action = action;
+    step.reward = reward;
+    step.score = static_cast<int16_t>(round.getScore());
+    step.TPS = static_cast<uint8_t>(round.getSpeed());
+    auto& apples = round.getApples();
+    for (size_t i = 0; i < apples.size() && i < APPLE_COLUMNS; i++) {
+        step.apples[i * 2] = static_cast<int16_t>(apples[i]->grid_x);
+        step.apples[i * 2 + 1] = static_cast<int16_t>(apples[i]->grid_y);
+    }
+    return step;
+}
+
+// 每个值与前一个值的差做zigzag后写成变长整数；差为0时写0，再写连续为0的个数。
+// 蛇头坐标每tick最多变1，苹果、分数、速度大部分tick不变，通常每行只要几个bit。
+void dataset::encodeColumn(const int32_t* values, uint32_t count, std::vector<uint8_t>& out)
+{
+    int32_t previous = 0;
+    uint32_t i = 0;
+    while (i < count) {
+        int32_t delta = static_cast<int32_t>(static_cast<uint32_t>(values[i]) - static_cast<uint32_t>(previous));
+        if (delta == 0) {
+            uint32_t run = 1;
+            while (i + run < count && values[i + run] == previous) run++;
+            out.push_back(0);
+            putVarint(out, run);
+            i += run;
+            continue;
+        }
+        putVarint(out, zigzag(delta));
+        previous = values[i];
+        i++;
+    }
+}
+
+bool dataset::decodeColumn(const uint8_t* data, size_t size, int32_t* values, uint32_t count)
+{
+    const uint8_t* p = data;
+    const uint8_t* end = data + size;
+    int32_t previous = 0;
+    uint32_t i = 0;
+    while (i < count) {
+        uint32_t token;
+        if (!getVarint(p, end, token)) return false;
+        if (token == 0) {
+            uint32_t run;
+            if (!getVarint(p, end, run) || run > count - i) return false;
+            std::fill(values + i, values + i + run, previous);
+            i += run;
+            continue;
+        }
+        previous = static_cast<int32_t>(static_cast<uint32_t>(previous) + static_cast<uint32_t>(unzigzag(token)));
+        values[i++] = previous;
+    }
+    return true;
+}
+
+bool dataset::Writer::open(const std::string& path)
+{
+    close();
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Failed to open " << path << " for writing" << std::endl;
+        return false;
+    }
+    // 后台线程按chunk写入，给大一点的缓冲减少系统调用
+    std::setvbuf(file, nullptr, _IOFBF, 1 << 20);
+
+    std::vector<uint8_t> header(MAGIC, MAGIC + 8);
+    put<uint32_t>(header, VERSION);
+    put<uint32_t>(header, COLUMN_COUNT);
+    rows = 0;
+    bytesWritten = 0;
+    directory.clear();
+    closing = false;
+    failed = false;
+    if (!writeBytes(header.data(), header.size())) return false;
+
+    current.reset(new Chunk());
+    worker = std::thread([this] { workerLoop(); });
+    return true;
+}
+
+void dataset::Writer::append(const Step& step)
+{
+    if (!current) return;
+    int32_t values[COLUMN_COUNT] = {
+        static_cast<int32_t>(step.episode), static_cast<int32_t>(step.tick), step.headX, step.headY,
+        step.direction, step.action, step.reward, step.score, step.TPS,
+        step.apples[0], step.apples[1], step.apples[2], step.apples[3], step.apples[4], step.apples[5],
+    };
+    for (int c = 0; c < COLUMN_COUNT; c++) {
+        current->columns[c].push_back(values[c]);
+    }
+    current->rows++;
+    rows++;
+    if (current->rows >= CHUNK_ROWS) submit();
+}
+
+void dataset::Writer::submit()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this] { return queue.size() < MAX_QUEUED; });
+    queue.push_back(std::move(current));
+
+    if (!spare.empty()) {
+        current = std::move(spare.back());
+        spare.pop_back();
+    }
+    else {
+        current.reset(new Chunk());
+    }
+    lock.unlock();
+    changed.notify_all();
+
+    current->firstRow = rows;
+    current->rows = 0;
+    for (auto& column : current->columns) {
+        column.clear();
+        column.reserve(CHUNK_ROWS);
+    }
+}
+
+void dataset::Writer::workerLoop()
+{
+    while (true) {
+        std::unique_ptr<Chunk> chunk;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [this] { return closing || !queue.empty(); });
+            if (queue.empty()) return;
+            chunk = std::move(queue.front());
+            queue.pop_front();
+        }
+        changed.notify_all();
+
+        bool ok = writeChunk(*chunk);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!ok) failed = true;
+        spare.push_back(std::move(chunk));
+    }
+}
+
+bool dataset::Writer::writeChunk(const Chunk& chunk)
+{
+    ChunkInfo info;
+    info.firstRow = chunk.firstRow;
+    info.rows = chunk.rows;
+    for (int c = 0; c < COLUMN_COUNT; c++) {
+        const auto& values = chunk.columns[c];
+        encoded.clear();
+        encodeColumn(values.data(), chunk.rows, encoded);
+
+        // 原始数据按8字节对齐，读取时可以直接当int32数组用
+        auto& column = info.columns[c];
+        if (encoded.size() < values.size() * sizeof(int32_t)) {
+            column.encoding = DELTA_RLE;
+            column.offset = bytesWritten;
+            column.size = static_cast<uint32_t>(encoded.size());
+            if (!writeBytes(encoded.data(), encoded.size())) return false;
+        }
+        else {
+            static const uint8_t zeros[8] = {};
+            if (!writeBytes(zeros, (8 - bytesWritten % 8) % 8)) return false;
+            column.encoding = RAW;
+            column.offset = bytesWritten;
+            column.size = static_cast<uint32_t>(values.size() * sizeof(int32_t));
+            encoded.clear();
+            for (auto value : values) put<int32_t>(encoded, value);
+            if (!writeBytes(encoded.data(), encoded.size())) return false;
+        }
+    }
+    directory.push_back(info);
+    return true;
+}
+
+bool dataset::Writer::writeBytes(const void* data, size_t size)
+{
+    if (size > 0 && std::fwrite(data, 1, size, file) != size) {
+        std::cerr << "Failed to write dataset" << std::endl;
+        return false;
+    }
+    bytesWritten += size;
+    return true;
+}
+
+bool dataset::Writer::close()
+{
+    if (!file) return true;
+    if (current && current->rows > 0) submit();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closing = true;
+    }
+    changed.notify_all();
+    if (worker.joinable()) worker.join();
+    current.reset();
+    queue.clear();
+    spare.clear();
+
+    std::vector<uint8_t> footer;
+    uint64_t directoryOffset = bytesWritten;
+    for (auto& info : directory) {
+        put<uint64_t>(footer, info.firstRow);
+        put<uint32_t>(footer, info.rows);
+        for (auto& column : info.columns) {
+            put<uint64_t>(footer, column.offset);
+            put<uint32_t>(footer, column.size);
+            footer.push_back(column.encoding);
+        }
+    }
+    put<uint64_t>(footer, directoryOffset);
+    put<uint32_t>(footer, static_cast<uint32_t>(directory.size()));
+    put<uint32_t>(footer, COLUMN_COUNT);
+    footer.insert(footer.end(), MAGIC, MAGIC + 8);
+    bool ok = !failed && writeBytes(footer.data(), footer.size());
+    ok = std::fclose(file) == 0 && ok;
+    file = nullptr;
+    return ok;
+}
+
+std::atomic<uint64_t> dataset::Reader::openCount{0};
+
+bool dataset::Reader::open(const std::string& path)
+{
+    close();
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        std::cerr << "Failed to open " << path << std::endl;
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(handle, &fileSize);
+    size = static_cast<size_t>(fileSize.QuadPart);
+    HANDLE mapping = size ? CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+    void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    fileHandle = handle;
+    mappingHandle = mapping;
+    if (!view) {
+        std::cerr << "Failed to map " << path << std::endl;
+        close();
+        return false;
+    }
+    data = static_cast<const uint8_t*>(view);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Failed to open " << path << std::endl;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        std::cerr << "Failed to stat " << path << std::endl;
+        ::close(fd);
+        return false;
+    }
+    size = static_cast<size_t>(info.st_size);
+    void* view = size ? mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (view == MAP_FAILED) {
+        std::cerr << "Failed to map " << path << std::endl;
+        size = 0;
+        return false;
+    }
+    // 扫描基本是顺序读，让内核多预读
+    madvise(view, size, MADV_SEQUENTIAL);
+    data = static_cast<const uint8_t*>(view);
+#endif
+
+    if (size < HEADER_SIZE + TRAILER_SIZE || std::memcmp(data, MAGIC, 8) != 0
+            || std::memcmp(data + size - 8, MAGIC, 8) != 0 || get<uint32_t>(data + 8) != VERSION) {
+        std::cerr << path << " is not a complete trajectory file" << std::endl;
+        close();
+        return false;
+    }
+    const uint8_t* trailer = data + size - TRAILER_SIZE;
+    uint64_t directoryOffset = get<uint64_t>(trailer);
+    uint32_t chunkCount = get<uint32_t>(trailer + 8);
+    if (get<uint32_t>(trailer + 12) != COLUMN_COUNT
+            || directoryOffset + static_cast<uint64_t>(chunkCount) * CHUNK_ENTRY_SIZE != size - TRAILER_SIZE) {
+        std::cerr << path << " has a corrupt chunk directory" << std::endl;
+        close();
+        return false;
+    }
+
+    const uint8_t* p = data + directoryOffset;
+    chunks.resize(chunkCount);
+    uint64_t nextRow = 0;
+    for (auto& info : chunks) {
+        info.firstRow = get<uint64_t>(p);
+        info.rows = get<uint32_t>(p + 8);
+        p += 12;
+        // 各chunk的行必须从0开始首尾相接，否则findChunk找不到行所在的chunk
+        if (info.firstRow != nextRow || info.rows == 0) {
+            std::cerr << path << " has a corrupt chunk directory" << std::endl;
+            close();
+            return false;
+        }
+        nextRow += info.rows;
+        for (auto& column : info.columns) {
+            column.offset = get<uint64_t>(p);
+            column.size = get<uint32_t>(p + 8);
+            column.encoding = p[12];
+            p += 13;
+            if (column.offset + column.size > directoryOffset
+                    || (column.encoding == RAW && column.size != info.rows * sizeof(int32_t))) {
+                std::cerr << path << " has a corrupt column" << std::endl;
+                close();
+                return false;
+            }
+        }
+    }
+    rows = nextRow;
+    generation = ++openCount;
+    return true;
+}
+
+void dataset::Reader::close()
+{
+#ifdef _WIN32
+    if (data) UnmapViewOfFile(data);
+    if (mappingHandle) CloseHandle(mappingHandle);
+    if (fileHandle) CloseHandle(fileHandle);
+    fileHandle = mappingHandle = nullptr;
+#else
+    if (data) munmap(const_cast<uint8_t*>(data), size);
+#endif
+    data = nullptr;
+    size = 0;
+    rows = 0;
+    generation = 0;
+    chunks.clear();
+}
+
+const int32_t* dataset::Reader::rawColumn(size_t chunk, Column column) const
+{
+    auto& info = chunks[chunk].columns[column];
+    if (info.encoding != RAW) return nullptr;
+    return reinterpret_cast<const int32_t*>(data + info.offset);
+}
+
+bool dataset::Reader::readColumn(size_t chunk, Column column, std::vector<int32_t>& out) const
+{
+    auto& info = chunks[chunk];
+    auto& entry = info.columns[column];
+    out.resize(info.rows);
+    if (entry.encoding == RAW) {
+        std::memcpy(out.data(), data + entry.offset, entry.size);
+        return true;
+    }
+    return decodeColumn(data + entry.offset, entry.size, out.data(), info.rows);
+}
+
+size_t dataset::Reader::findChunk(uint64_t row) const
+{
+    auto found = std::upper_bound(chunks.begin(), chunks.end(), row,
+        [](uint64_t value, const ChunkInfo& info) { return value < info.firstRow; });
+    return static_cast<size_t>(found - chunks.begin()) - 1;
+}
+
+bool dataset::Reader::readStep(uint64_t row, Step& step) const
+{
+    if (row >= rows) return false;
+    // 按generation而不是this区分文件：同一个Reader重新open，或新的Reader恰好分配在旧的地址上，都不会用到旧数据
+    struct Cache {
+        uint64_t generation = 0;
+        size_t chunk = 0;
+        std::vector<int32_t> columns[COLUMN_COUNT];
+    };
+    static thread_local Cache cache;
+
+    size_t chunk = findChunk(row);
+    if (cache.generation != generation || cache.chunk != chunk) {
+        cache.generation = 0;
+        for (int c = 0; c < COLUMN_COUNT; c++) {
+            if (!readColumn(chunk, static_cast<Column>(c), cache.columns[c])) return false;
+        }
+        cache.generation = generation;
+        cache.chunk = chunk;
+    }
+
+    size_t i = static_cast<size_t>(row - chunks[chunk].firstRow);
+    auto value = [&](Column column) { return cache.columns[column][i]; };
+    step.episode = static_cast<uint32_t>(value(EPISODE));
+    step.tick = static_cast<uint32_t>(value(TICK));
+    step.headX = static_cast<int16_t>(value(HEAD_X));
+    step.headY = static_cast<int16_t>(value(HEAD_Y));
+    step.direction = static_cast<uint8_t>(value(DIRECTION));
+    step.action = static_cast<uint8_t>(value(ACTION));
+    step.reward = static_cast<int8_t>(value(REWARD));
+    step.score = static_cast<int16_t>(value(SCORE));
+    step.TPS = static_cast<uint8_t>(value(TPS));
+    for (uint32_t a = 0; a < APPLE_COLUMNS * 2; a++) {
+        step.apples[a] = static_cast<int16_t>(value(static_cast<Column>(APPLE0_X + a)));
+    }
+    return true;
+}
+
+void dataset::Reader::scan(uint32_t columnMask, const std::function<void(const ChunkView&)>& fn, int threads) const
+{
+    utils::ThreadPool pool(threads);
+    pool.parallelFor(chunks.size(), [&](size_t begin, size_t end) {
+        std::vector<int32_t> buffers[COLUMN_COUNT];
+        for (size_t chunk = begin; chunk < end; chunk++) {
+            ChunkView view;
+            view.chunk = chunk;
+            view.firstRow = chunks[chunk].firstRow;
+            view.rows = chunks[chunk].rows;
+            for (int c = 0; c < COLUMN_COUNT; c++) {
+                if (!(columnMask & (1u << c))) continue;
+                // RAW的列直接指向映射，不需要解码
+                view.columns[c] = rawColumn(chunk, static_cast<Column>(c));
+                if (view.columns[c]) continue;
+                buffers[c].resize(view.rows);
+                auto& entry = chunks[chunk].columns[c];
+                if (!decodeColumn(data + entry.offset, entry.size, buffers[c].data(), view.rows)) {
+                    std::cerr << "Corrupt column " << columnName(static_cast<Column>(c)) << " in chunk " << chunk << std::endl;
+                    buffers[c].assign(view.rows, 0);
+                }
+                view.columns[c] = buffers[c].data();
+            }
+            fn(view);
+        }
+    });
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+// 轨迹数据集：每个tick一行(状态, 动作, 奖励)，按列存储。
+// 文件由若干chunk组成，每个chunk每列单独编码（差分+零游程+变长整数，压不小时存原始int32），
+// 文件末尾是chunk目录。写入在后台线程编码和落盘；读取时mmap整个文件，按chunk并行解码。
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace snake {
+    class Round;
+}
+
+namespace dataset {
+    enum Column : uint8_t {
+        EPISODE, TICK, HEAD_X, HEAD_Y, DIRECTION, ACTION, REWARD, SCORE, TPS,
+        APPLE0_X, APPLE0_Y, APPLE1_X, APPLE1_Y, APPLE2_X, APPLE2_Y,
+        COLUMN_COUNT
+    };
+    enum Encoding : uint8_t { RAW = 0, DELTA_RLE = 1 };
+
+    constexpr uint32_t APPLE_COLUMNS = 3;
+    constexpr uint32_t ALL_COLUMNS = (1u << COLUMN_COUNT) - 1;
+    constexpr uint8_t NO_ACTION = 0xFF;
+    const char* columnName(Column column);
+
+    struct Step;
+    struct ChunkInfo;
+    struct ChunkView;
+    class Writer;
+    class Reader;
+
+    // 从Round的当前状态生成一行，action为这个tick玩家输入的方向
+    Step makeStep(snake::Round& round, uint32_t episode, uint8_t action, int8_t reward);
+
+    // 列编码，out追加写入
+    void encodeColumn(const int32_t* values, uint32_t count, std::vector<uint8_t>& out);
+    bool decodeColumn(const uint8_t* data, size_t size, int32_t* values, uint32_t count);
+}
+
+struct dataset::Step {
+    uint32_t episode = 0;
+    uint32_t tick = 0;
+    int16_t headX = 0, headY = 0;
+    uint8_t direction = 0;
+    uint8_t action = NO_ACTION;
+    int8_t reward = 0;
+    int16_t score = 0;
+    uint8_t TPS = 0;
+    int16_t apples[APPLE_COLUMNS * 2] = {}; // x0, y0, x1, y1, x2, y2
+};
+
+struct dataset::ChunkInfo {
+    uint64_t firstRow = 0;
+    uint32_t rows = 0;
+    struct {
+        uint64_t offset;
+        uint32_t size;
+        uint8_t encoding;
+    } columns[COLUMN_COUNT];
+};
+
+// 扫描时交给回调的一个chunk，未请求的列为nullptr
+struct dataset::ChunkView {
+    size_t chunk = 0;
+    uint64_t firstRow = 0;
+    uint32_t rows = 0;
+    const int32_t* columns[COLUMN_COUNT] = {};
+};
+
+class dataset::Writer {
+public:
+    static constexpr uint32_t CHUNK_ROWS = 65536;
+    static constexpr size_t MAX_QUEUED = 4; // 后台来不及写时append会等待，限制内存
+
+    ~Writer() { close(); }
+
+    bool open(const std::string& path);
+    // 只写入内存中的列，满一个chunk交给后台线程。不是线程安全的。
+    void append(const Step& step);
+    void append(const std::vector<Step>& steps) {
+        for (auto& step : steps) append(step);
+    }
+    // 写出剩余数据和目录，等待后台线程结束
+    bool close();
+
+    uint64_t getRows() const { return rows; }
+    uint64_t getBytesWritten() const { return bytesWritten; }
+
+private:
+    struct Chunk {
+        uint64_t firstRow = 0;
+        uint32_t rows = 0;
+        std::vector<int32_t> columns[COLUMN_COUNT];
+    };
+
+    std::FILE* file = nullptr;
+    uint64_t rows = 0;
+    std::unique_ptr<Chunk> current;
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::unique_ptr<Chunk>> queue;
+    std::vector<std::unique_ptr<Chunk>> spare; // 写完的chunk留着复用内存
+    bool closing = false;
+    bool failed = false;
+
+    // 以下只由后台线程访问
+    std::vector<ChunkInfo> directory;
+    std::atomic<uint64_t> bytesWritten{0};
+    std::vector<uint8_t> encoded;
+
+    void submit();
+    void workerLoop();
+    bool writeChunk(const Chunk& chunk);
+    bool writeBytes(const void* data, size_t size);
+};
+
+class dataset::Reader {
+public:
+    ~Reader() { close(); }
+
+    bool open(const std::string& path);
+    void close();
+
+    uint64_t getRows() const { return rows; }
+    size_t getChunkCount() const { return chunks.size(); }
+    size_t getFileSize() const { return size; }
+    const ChunkInfo& getChunk(size_t chunk) const { return chunks[chunk]; }
+
+    // 解码一个chunk的一列
+    bool readColumn(size_t chunk, Column column, std::vector<int32_t>& out) const;
+    // RAW编码的列直接返回映射中的数据，不拷贝；其它编码返回nullptr
+    const int32_t* rawColumn(size_t chunk, Column column) const;
+    // 随机读取一行。每个线程缓存最近解码的chunk，相邻的行不会重复解码。
+    bool readStep(uint64_t row, Step& step) const;
+    // 把所有chunk分给线程池并行解码，columnMask为需要的列（1 << Column）
+    void scan(uint32_t columnMask, const std::function<void(const ChunkView&)>& fn, int threads = 0) const;
+
+private:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    uint64_t rows = 0;
+    std::vector<ChunkInfo> chunks;
+    uint64_t generation = 0; // 每次open取一个新的编号，readStep的缓存据此判断是否还是同一个文件
+    static std::atomic<uint64_t> openCount;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+
+    size_t findChunk(uint64_t row) const;
+};
@@ -0,0 +1,135 @@
+// SpeedSnakeDataset generate <文件> [局数=10000] [线程数]   用AI模拟单人对局并记录每个tick
+// SpeedSnakeDataset scan <文件> [线程数]                    并行扫描全部列，输出统计和吞吐量
+// SpeedSnakeDataset dump <文件> <起始行> [行数=20]          随机读取若干行
+
+#include "utils.h"
+#include "dataset.h"
+#include "thread_pool.h"
+
+#include <atomic>
+#include <iomanip>
+#include <mutex>
+#include <string>
+
+namespace {
+    constexpr int MAX_EPISODE_TICKS = 5000;
+
+    int generate(const std::string& path, int episodes, int threads) {
+        dataset::Writer writer;
+        if (!writer.open(path)) return 1;
+        std::mutex writerMutex;
+        std::atomic<uint64_t> simulatedTicks{0};
+
+        auto start = Clock::now();
+        utils::ThreadPool pool(threads);
+        pool.parallelFor(episodes, [&](size_t begin, size_t end) {
+            std::vector<dataset::Step> steps;
+            for (size_t episode = begin; episode < end; episode++) {
+                snake::Round round("Episode", 1, 5, 0x5EED0000ull + episode);
+                utils::Rng rng(episode);
+                steps.clear();
+                while (!round.getIsGameOver() && round.getTick() < MAX_EPISODE_TICKS) {
+                    auto action = snake::autopilot(round, rng);
+                    steps.push_back(dataset::makeStep(round, static_cast<uint32_t>(episode), static_cast<uint8_t>(action), 0));
+                    round.playerMove(action);
+                    round.tick();
+                    auto events = round.pollEvents();
+                    if (events & snake::EVENT_GAME_OVER) steps.back().reward = -1;
+                    else if (events & snake::EVENT_EAT) steps.back().reward = 1;
+                }
+                simulatedTicks += steps.size();
+                // 整局一次性追加，同一局的行在文件中是连续的
+                std::lock_guard<std::mutex> lock(writerMutex);
+                writer.append(steps);
+            }
+        });
+        if (!writer.close()) return 1;
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        std::cout << episodes << " episodes, " << writer.getRows() << " rows, " << writer.getBytesWritten() << " bytes ("
+            << std::fixed << std::setprecision(2) << double(writer.getBytesWritten()) / std::max<uint64_t>(1, writer.getRows())
+            << " bytes/row, raw " << sizeof(int32_t) * dataset::COLUMN_COUNT << ") in " << seconds << " s, "
+            << std::setprecision(0) << writer.getRows() / seconds << " rows/s" << std::endl;
+        return 0;
+    }
+
+    int scan(const std::string& path, int threads) {
+        dataset::Reader reader;
+        if (!reader.open(path)) return 1;
+
+        struct Totals {
+            std::atomic<uint64_t> rows{0}, episodes{0}, eaten{0}, deaths{0};
+            std::atomic<int> maxScore{0};
+            std::atomic<uint64_t> actions[5] = {};
+        } totals;
+
+        auto start = Clock::now();
+        reader.scan(dataset::ALL_COLUMNS, [&](const dataset::ChunkView& view) {
+            uint64_t episodes = 0, eaten = 0, deaths = 0;
+            uint64_t actions[5] = {};
+            int maxScore = 0;
+            auto tick = view.columns[dataset::TICK];
+            auto reward = view.columns[dataset::REWARD];
+            auto action = view.columns[dataset::ACTION];
+            auto score = view.columns[dataset::SCORE];
+            for (uint32_t i = 0; i < view.rows; i++) {
+                if (tick[i] == 0) episodes++;
+                if (reward[i] > 0) eaten++;
+                if (reward[i] < 0) deaths++;
+                actions[action[i] < 4 ? action[i] : 4]++;
+                maxScore = std::max(maxScore, score[i]);
+            }
+            totals.rows += view.rows;
+            totals.episodes += episodes;
+            totals.eaten += eaten;
+            totals.deaths += deaths;
+            for (int a = 0; a < 5; a++) totals.actions[a] += actions[a];
+            int previous = totals.maxScore.load();
+            while (maxScore > previous && !totals.maxScore.compare_exchange_weak(previous, maxScore)) {}
+        }, threads);
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        std::cout << reader.getChunkCount() << " chunks, " << totals.rows << " rows, " << totals.episodes << " episodes, "
+            << totals.eaten << " apples, " << totals.deaths << " deaths, max score " << totals.maxScore << std::endl;
+        std::cout << "actions N/W/S/E/none: " << totals.actions[0] << "/" << totals.actions[1] << "/" << totals.actions[2]
+            << "/" << totals.actions[3] << "/" << totals.actions[4] << std::endl;
+        std::cout << std::fixed << std::setprecision(3) << "scanned " << reader.getFileSize() / 1e6 << " MB in " << seconds * 1000
+            << " ms: " << reader.getFileSize() / 1e9 / seconds << " GB/s file, "
+            << totals.rows * sizeof(int32_t) * dataset::COLUMN_COUNT / 1e9 / seconds << " GB/s decoded, "
+            << std::setprecision(0) << totals.rows / seconds << " rows/s" << std::endl;
+        return 0;
+    }
+
+    int dump(const std::string& path, uint64_t first, int count) {
+        dataset::Reader reader;
+        if (!reader.open(path)) return 1;
+        dataset::Step step;
+        for (uint64_t row = first; row < first + count && reader.readStep(row, step); row++) {
+            std::cout << row << ": episode " << step.episode << " tick " << step.tick
+                << " head (" << step.headX << ", " << step.headY << ") dir " << int(step.direction)
+                << " action " << int(step.action) << " reward " << int(step.reward)
+                << " score " << step.score << " TPS " << int(step.TPS) << " apples";
+            for (uint32_t a = 0; a < dataset::APPLE_COLUMNS; a++) {
+                std::cout << " (" << step.apples[a * 2] << ", " << step.apples[a * 2 + 1] << ")";
+            }
+            std::cout << std::endl;
+        }
+        return 0;
+    }
+}
+
+int main(int argc, char* argv[]){
+    utils::verbose = false;
+    std::string command = argc >= 2 ? argv[1] : "";
+    if (command == "generate" && argc >= 3) {
+        return generate(argv[2], argc >= 4 ? std::atoi(argv[3]) : 10000, argc >= 5 ? std::atoi(argv[4]) : 0);
+    }
+    if (command == "scan" && argc >= 3) {
+        return scan(argv[2], argc >= 4 ? std::atoi(argv[3]) : 0);
+    }
+    if (command == "dump" && argc >= 4) {
+        return dump(argv[2], std::strtoull(argv[3], nullptr, 10), argc >= 5 ? std::atoi(argv[4]) : 20);
+    }
+    std::cerr << "Usage: SpeedSnakeDataset generate <file> [episodes] [threads] | scan <file> [threads] | dump <file> <row> [count]" << std::endl;
+    return 1;
+}
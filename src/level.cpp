@@ -0,0 +1,261 @@
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "level.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+namespace {
+    const char MAGIC[8] = { 'S', 'S', 'L', 'E', 'V', 'E', 'L', '1' };
+    constexpr uint32_t VERSION = 1;
+    constexpr size_t SPAWN_SIZE = 8;
+    constexpr size_t SPEED_STEP_SIZE = 4;
+    // 与Direction一致：NORTH, WEST, SOUTH, EAST
+    constexpr int DIR_DX[4] = { 0, -1, 0, 1 };
+    constexpr int DIR_DY[4] = { -1, 0, 1, 0 };
+
+    template <typename T>
+    void put(std::vector<uint8_t>& out, size_t offset, T value) {
+        for (size_t i = 0; i < sizeof(T); i++) out[offset + i] = static_cast<uint8_t>(static_cast<uint64_t>(value) >> (i * 8));
+    }
+    template <typename T>
+    T get(const uint8_t* p) {
+        uint64_t value = 0;
+        for (size_t i = 0; i < sizeof(T); i++) value |= static_cast<uint64_t>(p[i]) << (i * 8);
+        return static_cast<T>(value);
+    }
+
+    // 位图的一个字节展开成8格，每格为0或WALL；同时记下每个字节中墙的数量
+    struct ExpandTable {
+        uint64_t rows[256];
+        uint8_t walls[256];
+        ExpandTable() {
+            for (int byte = 0; byte < 256; byte++) {
+                uint8_t cells[8];
+                walls[byte] = 0;
+                for (int bit = 0; bit < 8; bit++) {
+                    cells[bit] = (byte >> bit) & 1 ? snake::Board::WALL : snake::Board::EMPTY;
+                    walls[byte] += (byte >> bit) & 1;
+                }
+                std::memcpy(&rows[byte], cells, 8);
+            }
+        }
+    };
+    const ExpandTable expandTable;
+}
+
+bool snake::Level::open(const std::string& path)
+{
+    close();
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+        std::cerr << "Failed to open level " << path << std::endl;
+        return false;
+    }
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(handle, &fileSize);
+    size = static_cast<size_t>(fileSize.QuadPart);
+    HANDLE mapping = size ? CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+    void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    fileHandle = handle;
+    mappingHandle = mapping;
+    if (!view) {
+        std::cerr << "Failed to map level " << path << std::endl;
+        close();
+        return false;
+    }
+    data = static_cast<const uint8_t*>(view);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cerr << "Failed to open level " << path << std::endl;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        std::cerr << "Failed to stat level " << path << std::endl;
+        ::close(fd);
+        return false;
+    }
+    size = static_cast<size_t>(info.st_size);
+    void* view = size ? mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (view == MAP_FAILED) {
+        std::cerr << "Failed to map level " << path << std::endl;
+        size = 0;
+        return false;
+    }
+    // 校验和写入Board都是从头到尾读一遍。advice不是位标志，要分开设置
+    madvise(view, size, MADV_SEQUENTIAL);
+    madvise(view, size, MADV_WILLNEED);
+    data = static_cast<const uint8_t*>(view);
+#endif
+
+    if (!validate(path)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void snake::Level::close()
+{
+#ifdef _WIN32
+    if (data) UnmapViewOfFile(data);
+    if (mappingHandle) CloseHandle(mappingHandle);
+    if (fileHandle) CloseHandle(fileHandle);
+    fileHandle = mappingHandle = nullptr;
+#else
+    if (data) munmap(const_cast<uint8_t*>(data), size);
+#endif
+    data = nullptr;
+    bitmap = nullptr;
+    size = 0;
+    width = height = 0;
+    spawns.clear();
+    speedCurve.clear();
+}
+
+bool snake::Level::validate(const std::string& path)
+{
+    auto fail = [&path](const char* reason) {
+        std::cerr << "Invalid level " << path << ": " << reason << std::endl;
+        return false;
+    };
+    if (size < HEADER_SIZE || std::memcmp(data, MAGIC, 8) != 0) return fail("not a level file");
+    if (get<uint32_t>(data + 8) != VERSION) return fail("unsupported version");
+    if (get<uint32_t>(data + 36) != size) return fail("truncated");
+
+    width = get<uint16_t>(data + 12);
+    height = get<uint16_t>(data + 14);
+    appleCount = get<uint16_t>(data + 16);
+    size_t spawnCount = get<uint16_t>(data + 18);
+    size_t speedSteps = get<uint16_t>(data + 20);
+    size_t bitmapOffset = get<uint32_t>(data + 24);
+    size_t spawnOffset = get<uint32_t>(data + 28);
+    size_t speedOffset = get<uint32_t>(data + 32);
+    const char* rawName = reinterpret_cast<const char*>(data + 40);
+    name.assign(rawName, strnlen(rawName, NAME_SIZE));
+
+    if (width < MIN_SIZE || height < MIN_SIZE || width > MAX_SIZE || height > MAX_SIZE) return fail("bad size");
+    rowBytes = (static_cast<size_t>(width) + 7) / 8;
+    if (bitmapOffset < HEADER_SIZE || bitmapOffset + rowBytes * height > size) return fail("bitmap out of range");
+    if (spawnCount > MAX_SPAWNS || spawnOffset + spawnCount * SPAWN_SIZE > size) return fail("bad spawn points");
+    if (speedOffset + speedSteps * SPEED_STEP_SIZE > size) return fail("bad speed curve");
+    bitmap = data + bitmapOffset;
+
+    // 每行末尾多出来的位必须为0，同时数出空格子
+    uint8_t tailMask = width % 8 ? static_cast<uint8_t>(0xFF << (width % 8)) : 0;
+    long walls = 0;
+    for (int y = 0; y < height; y++) {
+        const uint8_t* row = bitmap + static_cast<size_t>(y) * rowBytes;
+        if (row[rowBytes - 1] & tailMask) return fail("padding bits set");
+        for (size_t i = 0; i < rowBytes; i++) walls += expandTable.walls[row[i]];
+    }
+    freeCells = static_cast<int>(static_cast<long>(width) * height - walls);
+
+    // 出生点的整条蛇都要在界内、不压墙、互不重叠
+    std::vector<std::pair<int, int>> occupied;
+    for (size_t i = 0; i < spawnCount; i++) {
+        const uint8_t* p = data + spawnOffset + i * SPAWN_SIZE;
+        Spawn spawn = { get<uint16_t>(p), get<uint16_t>(p + 2), p[4], p[5] };
+        if (spawn.direction > EAST || spawn.length < 2 || spawn.length > 10) return fail("bad spawn point");
+        for (int k = 0; k < spawn.length; k++) {
+            // 与Snake的构造函数一致：蛇身沿方向的反方向展开
+            int x = spawn.x - DIR_DX[spawn.direction] * k;
+            int y = spawn.y - DIR_DY[spawn.direction] * k;
+            if (x < 0 || y < 0 || x >= width || y >= height || isWall(x, y)) return fail("spawn point blocked");
+            for (auto& cell : occupied) {
+                if (cell.first == x && cell.second == y) return fail("spawn points overlap");
+            }
+            occupied.push_back({ x, y });
+        }
+        spawns.push_back(spawn);
+    }
+
+    if (appleCount < 1 || appleCount + static_cast<long>(occupied.size()) >= freeCells) return fail("bad apple count");
+
+    for (size_t i = 0; i < speedSteps; i++) {
+        const uint8_t* p = data + speedOffset + i * SPEED_STEP_SIZE;
+        SpeedStep step = { get<uint16_t>(p), get<uint16_t>(p + 2) };
+        if (step.TPS < 1 || step.TPS > 255) return fail("bad speed");
+        if (i == 0 ? step.score != 0 : step.score <= speedCurve.back().score) return fail("speed curve must start at 0 and increase");
+        speedCurve.push_back(step);
+    }
+    return true;
+}
+
+void snake::Level::stamp(Board& board) const
+{
+    for (int y = 0; y < height; y++) {
+        const uint8_t* row = bitmap + static_cast<size_t>(y) * rowBytes;
+        uint8_t* out = &board.cells[board.index(0, y)];
+        int x = 0;
+        for (; x + 8 <= width; x += 8) {
+            std::memcpy(out + x, &expandTable.rows[row[x >> 3]], 8);
+        }
+        for (; x < width; x++) {
+            out[x] = isWall(x, y) ? Board::WALL : Board::EMPTY;
+        }
+    }
+}
+
+bool snake::Level::write(const std::string& path, const std::string& name, int width, int height,
+    const std::vector<uint8_t>& walls, int appleCount,
+    const std::vector<Spawn>& spawns, const std::vector<SpeedStep>& speedCurve)
+{
+    size_t rowBytes = (static_cast<size_t>(width) + 7) / 8;
+    size_t bitmapOffset = HEADER_SIZE;
+    size_t spawnOffset = (bitmapOffset + rowBytes * height + 7) / 8 * 8;
+    size_t speedOffset = spawnOffset + spawns.size() * SPAWN_SIZE;
+    size_t total = speedOffset + speedCurve.size() * SPEED_STEP_SIZE;
+
+    std::vector<uint8_t> out(total, 0);
+    std::memcpy(out.data(), MAGIC, 8);
+    put<uint32_t>(out, 8, VERSION);
+    put<uint16_t>(out, 12, width);
+    put<uint16_t>(out, 14, height);
+    put<uint16_t>(out, 16, appleCount);
+    put<uint16_t>(out, 18, spawns.size());
+    put<uint16_t>(out, 20, speedCurve.size());
+    put<uint32_t>(out, 24, bitmapOffset);
+    put<uint32_t>(out, 28, spawnOffset);
+    put<uint32_t>(out, 32, speedOffset);
+    put<uint32_t>(out, 36, total);
+    std::memcpy(out.data() + 40, name.data(), std::min(name.size(), NAME_SIZE));
+
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            if (walls[static_cast<size_t>(y) * width + x]) out[bitmapOffset + y * rowBytes + (x >> 3)] |= 1 << (x & 7);
+        }
+    }
+    for (size_t i = 0; i < spawns.size(); i++) {
+        size_t p = spawnOffset + i * SPAWN_SIZE;
+        put<uint16_t>(out, p, spawns[i].x);
+        put<uint16_t>(out, p + 2, spawns[i].y);
+        out[p + 4] = spawns[i].direction;
+        out[p + 5] = spawns[i].length;
+    }
+    for (size_t i = 0; i < speedCurve.size(); i++) {
+        put<uint16_t>(out, speedOffset + i * SPEED_STEP_SIZE, speedCurve[i].score);
+        put<uint16_t>(out, speedOffset + i * SPEED_STEP_SIZE + 2, speedCurve[i].TPS);
+    }
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Failed to create level " << path << std::endl;
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(out.data()), out.size());
+    return static_cast<bool>(file);
+}
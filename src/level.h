@@ -0,0 +1,94 @@
+#pragma once
+
+// 预编译的二进制关卡：障碍位图、出生点、苹果数量和速度曲线。
+// 打开时整个文件mmap进来并只校验一次，之后按位图直接把墙写进Board，不经过任何中间结构。
+//
+// 文件格式（小端）：
+//   0  "SSLEVEL1"
+//   8  u32 版本
+//   12 u16 宽, u16 高
+//   16 u16 苹果数量, u16 出生点数量
+//   20 u16 速度曲线的级数, u16 保留
+//   24 u32 位图偏移, u32 出生点偏移, u32 速度曲线偏移, u32 文件长度
+//   40 char[24] 名字，不足补0
+//   位图：每行 (宽+7)/8 字节，第x格是第x/8字节的第x%8位，1为墙
+//   出生点：每个8字节 u16 x, u16 y, u8 方向, u8 长度, u16 保留
+//   速度曲线：每级4字节 u16 分数, u16 TPS，分数从0开始严格递增
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace snake {
+    class Board;
+    class Level;
+}
+
+class snake::Level {
+public:
+    static constexpr int MIN_SIZE = 4;
+    static constexpr int MAX_SIZE = 4096;
+    static constexpr int MAX_SPAWNS = 8;
+    static constexpr size_t HEADER_SIZE = 64;
+    static constexpr size_t NAME_SIZE = 24;
+
+    struct Spawn {
+        int x, y;
+        uint8_t direction; // Direction，蛇身向反方向展开
+        uint8_t length;
+    };
+    struct SpeedStep {
+        int score; // 总分达到这个值时
+        int TPS;   // 切换到这个速度
+    };
+
+    Level() {}
+    ~Level() { close(); }
+    Level(const Level&) = delete;
+    Level& operator=(const Level&) = delete;
+
+    // 映射并校验，失败时输出原因并返回false
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return data != nullptr; }
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    const std::string& getName() const { return name; }
+    int getAppleCount() const { return appleCount; }
+    int getFreeCells() const { return freeCells; }
+    const std::vector<Spawn>& getSpawns() const { return spawns; }
+    const std::vector<SpeedStep>& getSpeedCurve() const { return speedCurve; }
+
+    bool isWall(int x, int y) const {
+        return (bitmap[static_cast<size_t>(y) * rowBytes + (x >> 3)] >> (x & 7)) & 1;
+    }
+    // 把墙写进board，board的尺寸必须与关卡相同；原有的墙会被清除
+    void stamp(Board& board) const;
+
+    // 写出关卡文件。walls按行排列，每格一个字节，非0为墙；不做校验，写完可用open检查
+    static bool write(const std::string& path, const std::string& name, int width, int height,
+        const std::vector<uint8_t>& walls, int appleCount,
+        const std::vector<Spawn>& spawns, const std::vector<SpeedStep>& speedCurve);
+
+private:
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    void* fileHandle = nullptr;
+    void* mappingHandle = nullptr;
+#endif
+
+    // 以下在校验时从映射中取出
+    int width = 0, height = 0;
+    size_t rowBytes = 0;
+    const uint8_t* bitmap = nullptr; // 指向映射内
+    std::string name;
+    int appleCount = 0;
+    int freeCells = 0;
+    std::vector<Spawn> spawns;
+    std::vector<SpeedStep> speedCurve;
+
+    bool validate(const std::string& path);
+};
@@ -0,0 +1,175 @@
+// SpeedSnakeLevel compile <文本关卡> <输出文件>           把文本关卡编译成二进制关卡
+// SpeedSnakeLevel generate <输出文件> <宽> <高> [墙的比例=0.2]  随机生成障碍，测试用
+// SpeedSnakeLevel bench <关卡文件> [次数=10]              测量打开校验、写入Board和整局切换的耗时
+//
+// 文本关卡每行一项，#开头为注释：
+//   name <名字>
+//   apples <数量>
+//   speed <分数> <TPS>              可以有多行，分数从0开始递增
+//   spawn <x> <y> <N|W|S|E> [长度=3] 可以有多行，依次为各玩家
+//   grid                            之后每行为地图的一行，#为墙，其它字符为空地
+
+#include "utils.h"
+#include "level.h"
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+namespace {
+    int compile(const std::string& input, const std::string& output) {
+        std::ifstream in(input);
+        if (!in) {
+            std::cerr << "Cannot open " << input << std::endl;
+            return 1;
+        }
+        std::string name = "Level", line;
+        int apples = 3;
+        std::vector<snake::Level::Spawn> spawns;
+        std::vector<snake::Level::SpeedStep> speedCurve;
+        std::vector<std::string> rows;
+        bool inGrid = false;
+        int lineNumber = 0;
+        while (std::getline(in, line)) {
+            lineNumber++;
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (inGrid) {
+                if (!line.empty()) rows.push_back(line);
+                continue;
+            }
+            std::istringstream fields(line);
+            std::string key;
+            if (!(fields >> key) || key[0] == '#') continue;
+            bool ok = true;
+            if (key == "name") {
+                std::getline(fields >> std::ws, name);
+            }
+            else if (key == "apples") {
+                ok = static_cast<bool>(fields >> apples);
+            }
+            else if (key == "speed") {
+                snake::Level::SpeedStep step;
+                ok = static_cast<bool>(fields >> step.score >> step.TPS);
+                speedCurve.push_back(step);
+            }
+            else if (key == "spawn") {
+                int x, y, length = 3;
+                std::string direction;
+                ok = static_cast<bool>(fields >> x >> y >> direction);
+                fields >> length;
+                const std::string names = "NWSE";
+                auto d = names.find(direction);
+                ok = ok && direction.size() == 1 && d != std::string::npos;
+                spawns.push_back({ x, y, static_cast<uint8_t>(d), static_cast<uint8_t>(length) });
+            }
+            else if (key == "grid") {
+                inGrid = true;
+            }
+            else {
+                ok = false;
+            }
+            if (!ok) {
+                std::cerr << input << ":" << lineNumber << ": cannot parse \"" << line << "\"" << std::endl;
+                return 1;
+            }
+        }
+        if (rows.empty()) {
+            std::cerr << input << ": missing grid" << std::endl;
+            return 1;
+        }
+
+        int width = static_cast<int>(rows[0].size()), height = static_cast<int>(rows.size());
+        std::vector<uint8_t> walls(static_cast<size_t>(width) * height);
+        for (int y = 0; y < height; y++) {
+            if (static_cast<int>(rows[y].size()) != width) {
+                std::cerr << input << ": grid row " << y << " has " << rows[y].size() << " cells, expected " << width << std::endl;
+                return 1;
+            }
+            for (int x = 0; x < width; x++) walls[static_cast<size_t>(y) * width + x] = rows[y][x] == '#';
+        }
+
+        if (!snake::Level::write(output, name, width, height, walls, apples, spawns, speedCurve)) return 1;
+        // 写完后按游戏加载时的规则检查一遍
+        snake::Level level;
+        if (!level.open(output)) {
+            std::remove(output.c_str());
+            return 1;
+        }
+        std::cout << output << ": " << name << ", " << width << "x" << height << ", " << level.getFreeCells()
+            << " free cells, " << spawns.size() << " spawns, " << speedCurve.size() << " speed steps" << std::endl;
+        return 0;
+    }
+
+    int generate(const std::string& output, int width, int height, double density) {
+        utils::Rng rng(static_cast<uint64_t>(width) * 65537 + height);
+        std::vector<uint8_t> walls(static_cast<size_t>(width) * height);
+        uint64_t threshold = static_cast<uint64_t>(density * 1000000);
+        for (auto& wall : walls) wall = rng.below(1000000) < threshold;
+
+        // 中间留出一块空地给出生点
+        int cx = width / 2, cy = height / 2;
+        for (int y = std::max(0, cy - 3); y <= std::min(height - 1, cy + 3); y++) {
+            for (int x = std::max(0, cx - 3); x <= std::min(width - 1, cx + 3); x++) {
+                walls[static_cast<size_t>(y) * width + x] = 0;
+            }
+        }
+        std::vector<snake::Level::Spawn> spawns = { { cx, cy, static_cast<uint8_t>(snake::NORTH), 3 } };
+        std::vector<snake::Level::SpeedStep> speedCurve = { { 0, 5 }, { 10, 8 }, { 30, 12 }, { 60, 16 } };
+        int apples = std::max(3, width * height / 65536);
+
+        auto name = "Random " + std::to_string(width) + "x" + std::to_string(height);
+        if (!snake::Level::write(output, name, width, height, walls, apples, spawns, speedCurve)) return 1;
+        snake::Level level;
+        if (!level.open(output)) return 1;
+        std::cout << output << ": " << name << ", " << level.getFreeCells() << " free cells, " << apples << " apples" << std::endl;
+        return 0;
+    }
+
+    double millisSince(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    int bench(const std::string& path, int count) {
+        double openMs = 0, stampMs = 0, loadMs = 0;
+        snake::Round round("Bench", 0, 5, 1);
+        for (int i = 0; i < count; i++) {
+            auto start = Clock::now();
+            snake::Level level;
+            if (!level.open(path)) return 1;
+            openMs += millisSince(start);
+
+            start = Clock::now();
+            snake::Board board(level.getWidth(), level.getHeight());
+            level.stamp(board);
+            stampMs += millisSince(start);
+
+            // 包括改变Board尺寸、出生、放苹果和重建连通区域
+            start = Clock::now();
+            if (!round.loadLevel(level)) return 1;
+            loadMs += millisSince(start);
+        }
+        snake::Level level;
+        level.open(path);
+        std::cout << level.getName() << " " << level.getWidth() << "x" << level.getHeight() << ", " << count << " runs, average: "
+            << std::fixed << std::setprecision(3) << "open+validate " << openMs / count << " ms, stamp " << stampMs / count
+            << " ms, Round::loadLevel " << loadMs / count << " ms" << std::endl;
+        return 0;
+    }
+}
+
+int main(int argc, char* argv[]){
+    utils::verbose = false;
+    std::string command = argc >= 2 ? argv[1] : "";
+    if (command == "compile" && argc >= 4) {
+        return compile(argv[2], argv[3]);
+    }
+    if (command == "generate" && argc >= 5) {
+        return generate(argv[2], std::atoi(argv[3]), std::atoi(argv[4]), argc >= 6 ? std::atof(argv[5]) : 0.2);
+    }
+    if (command == "bench" && argc >= 3) {
+        return bench(argv[2], argc >= 4 ? std::max(1, std::atoi(argv[3])) : 10);
+    }
+    std::cerr << "Usage: SpeedSnakeLevel compile <text> <output> | generate <output> <width> <height> [density] | bench <file> [runs]" << std::endl;
+    return 1;
+}
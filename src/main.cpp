@@ -4,6 +4,13 @@
 
 #include "utils.h"
 #include "constants.h"
+#include "audio.h"
+#include "arena.h"
+#include "netplay.h"
+#include "assets.h"
+#include "resources.h"
+#include "spectator.h"
+#include "results.h"
 
 #include <SDL3/SDL.h>
 #include <SDL3_image/SDL_image.h>
@@ -12,6 +19,7 @@
 #include <string>
 #include <chrono>
 #include <random>
+#include <cmath>
 
 // 使用高分辨率时钟
 using Clock = std::chrono::high_resolution_clock;
@@ -19,6 +27,7 @@ using Duration = std::chrono::duration<double, std::milli>;
 
 SDL_Window* window = NULL;
 SDL_Renderer* renderer = NULL;
+audio::AudioEngine audioEngine;
 
 //赖得改了awa
 SDL_Color color_bg = constants::color_bg, color_gridbg = constants::color_gridbg,
@@ -26,10 +35,12 @@ SDL_Color color_bg = constants::color_bg, color_gridbg = constants::color_gridbg
         color_bt_frame = constants::color_bt_frame, color_bt_text = constants::color_bt_text;
 
 bool ctn = true;
+bool showDebug = false; // F3切换调试信息
+double windowInitMs = 0; // SDL、窗口和音频初始化的用时
 
 class Label {
 protected:
-    SDL_Surface* textSurface;
+    SDL_Surface* textSurface = nullptr;
     std::string name;
     int x, y;
     SDL_Color textColor;
@@ -37,29 +48,25 @@ public:
     Label(int x, int y, std::string text, SDL_Color textColor, int textSize = 16, std::string name = ""): x(x), y(y) {
         if(name.empty()) this->name = text;
         this->textColor = textColor;
-        TTF_Font* font = TTF_OpenFont("./assets/VonwaonBitmap-16px.ttf", textSize);
+        TTF_Font* font = assets::shared().acquireFont(assets::DEFAULT_FONT, textSize);
         if (!font) {
-            std::cerr << "Failed to load font: " << SDL_GetError() << std::endl;
             return;
         }
-        const char* c_text = text.c_str();
-        int length = text.length();
-
-        textSurface = TTF_RenderText_Blended(font, c_text, length, textColor);
+        textSurface = resources::renderText(font, text, textColor);
+        assets::shared().release(font);
         if (!textSurface) {
             std::cerr << "Failed to create font surface: " << SDL_GetError() << std::endl;
-            TTF_CloseFont(font);
             return;
         }
 
         std::cout << "Label created: " << name << std::endl;
     }
     ~Label() {
-        SDL_DestroySurface(textSurface);
+        resources::destroySurface(textSurface);
         std::cout << "Label destroyed: " << name << std::endl;
     }
     void draw(SDL_Renderer* renderer) {
-        SDL_Texture* textTexture = SDL_CreateTextureFromSurface(renderer, textSurface);
+        SDL_Texture* textTexture = resources::createTextureFromSurface(renderer, textSurface);
         if (!textTexture) {
             std::cerr << "Failed to create texture: " << SDL_GetError() << std::endl;
             return;
@@ -68,13 +75,17 @@ public:
         float centerY = y + textSurface->h / 2;
         SDL_FRect dstrect = {float(centerX - textSurface->w / 2), float(centerY - textSurface->h / 2), float(textSurface->w), float(textSurface->h)};
         SDL_RenderTexture(renderer, textTexture, NULL, &dstrect);
-        SDL_DestroyTexture(textTexture);
+        resources::destroyTexture(textTexture);
     }
     void setText(std::string text) {
-        auto c_text = text.c_str();
-        int length = text.length();
-        TTF_Font* font = TTF_OpenFont("./assets/VonwaonBitmap-16px.ttf", 16);
-        textSurface = TTF_RenderText_Blended(font, c_text, length, textColor);
+        TTF_Font* font = assets::shared().acquireFont(assets::DEFAULT_FONT, 16);
+        if (!font) {
+            return;
+        }
+        // 旧的表面要先释放
+        resources::destroySurface(textSurface);
+        textSurface = resources::renderText(font, text, textColor);
+        assets::shared().release(font);
         if (!textSurface) {
             std::cerr << "Failed to create font surface: " << SDL_GetError() << std::endl;
             return;
@@ -92,18 +103,37 @@ public:
 };
 
 void windowInit(){
+    // 字体文件在后台读取，同时初始化SDL、窗口和音频
+    auto& assetManager = assets::shared();
+    for (float size : { 16.0f, 24.0f, 48.0f }) {
+        assetManager.requestFont(assets::DEFAULT_FONT, size);
+    }
+    assetManager.requestPixels(snake::snakeapple_pixel, 4, 4, 16);
+    for (auto pixels : { snake::snakehead_pixel, snake::snakebody_pixel, snake::snakehead2_pixel, snake::snakebody2_pixel }) {
+        assetManager.requestPixels(pixels, 2, 2, 8);
+    }
+    assetManager.startPreload();
+
+    auto initStart = Clock::now();
     SDL_Init(SDL_INIT_VIDEO);
     TTF_Init();
+    // 没有音频设备时游戏照常运行，只是没有声音
+    audioEngine.init();
     snake::testing();
     //创建一个窗口
     window = SDL_CreateWindow("Speed Snake", constants::WINDOW_WIDTH, constants::WINDOW_HEIGHT, NULL);
-    renderer = SDL_CreateRenderer(window, NULL);
+    renderer = resources::createRenderer(window);
     SDL_SetWindowPosition(window, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED);
-    
+    windowInitMs = Duration(Clock::now() - initStart).count();
+
+    // 打开字体，把精灵一次性上传成纹理
+    assetManager.finishPreload(renderer);
 }
 
 void windowDestroy(){
-    SDL_DestroyRenderer(renderer);
+    audioEngine.shutdown();
+    assets::shared().clear();
+    resources::destroyRenderer(renderer);
     SDL_DestroyWindow(window);
     TTF_Quit();
     SDL_Quit();
@@ -113,39 +143,309 @@ void gameInit() {
     
 }
 
+// 显示渲染内容，检查SDL资源是否在增长；第一帧时输出启动用时
+void present() {
+    SDL_RenderPresent(renderer);
+    static resources::LeakDetector leakDetector;
+    leakDetector.check();
+    static bool firstFrame = true;
+    if (!firstFrame) return;
+    firstFrame = false;
+    auto& stats = assets::shared().getStats();
+    std::cout << "First frame after " << assets::sinceLaunch() << " ms (window " << windowInitMs
+        << " ms, assets loaded in background " << stats.preloadMs << " ms, waited " << stats.waitMs
+        << " ms, upload " << stats.uploadMs << " ms, " << stats.fonts << " fonts, " << stats.textures << " textures)" << std::endl;
+}
+
 
 
 void drawFont(SDL_Renderer* renderer, std::string text, int x, int y, int size, SDL_Color color) {
-    TTF_Font* font = TTF_OpenFont("./assets/VonwaonBitmap-16px.ttf", size);
+    TTF_Font* font = assets::shared().acquireFont(assets::DEFAULT_FONT, size);
     if (!font) {
-        std::cerr << "Failed to load font: " << SDL_GetError() << std::endl;
         return;
     }
-    const char* c_text = text.c_str();
-    int length = text.length();
-
-    SDL_Surface* surface = TTF_RenderText_Blended(font, c_text, length, color);
+    SDL_Surface* surface = resources::renderText(font, text, color);
+    assets::shared().release(font);
     if (!surface) {
         std::cerr << "Failed to create font surface: " << SDL_GetError() << std::endl;
-        TTF_CloseFont(font);
         return;
     }
 
-    SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
+    SDL_Texture* texture = resources::createTextureFromSurface(renderer, surface);
     if (!texture) {
         std::cerr << "Failed to create texture: " << SDL_GetError() << std::endl;
-        SDL_DestroySurface(surface);
-        TTF_CloseFont(font);
+        resources::destroySurface(surface);
         return;
     }
     SDL_FRect dstrect = {(float)x, (float)y, (float)surface->w, (float)surface->h};
     SDL_RenderTexture(renderer, texture, NULL, &dstrect);
-    TTF_CloseFont(font);
-    SDL_DestroyTexture(texture);
+    resources::destroySurface(surface);
+    resources::destroyTexture(texture);
+}
+
+// 调试信息：各类SDL资源的存活数量和占用
+void drawDebugOverlay(SDL_Renderer* renderer) {
+    for (int i = 0; i < resources::CATEGORY_COUNT; i++) {
+        drawFont(renderer, resources::describe(static_cast<resources::Category>(i)), 10, 10 + i * 18, 16, {0, 255, 0, 255});
+    }
+}
+
+// 竞技场模式：SpeedSnake --arena [蛇的数量]
+void runArena(int snakeCount) {
+    int side = static_cast<int>(std::ceil(std::sqrt(double(snakeCount) * constants::ARENA_CELLS_PER_SNAKE)));
+    snake::Arena arena(side, side, snakeCount, std::random_device{}());
+    SDL_FRect area = {0, 120, constants::WINDOW_WIDTH, constants::WINDOW_WIDTH};
+
+    utils::Timer tickTimer;
+    tickTimer.reset();
+    double tickCost = 0;
+    bool paused = false;
+
+    while(ctn){
+        SDL_Event event;
+        auto stime = Clock::now();
+
+        while (SDL_PollEvent(&event)) {
+            if (event.type == SDL_EVENT_QUIT) ctn = false;
+            else if (event.type == SDL_EVENT_KEY_DOWN) {
+                if (event.key.key == SDLK_ESCAPE) ctn = false;
+                else if (event.key.key == SDLK_P) paused = !paused;
+            }
+        }
+
+        if (!paused && tickTimer.elapsed() >= 1000.0f / constants::ARENA_TPS) {
+            tickTimer.reset();
+            auto tstart = Clock::now();
+            arena.tick();
+            tickCost = Duration(Clock::now() - tstart).count();
+        }
+
+        SDL_SetRenderDrawColor(renderer, color_bg.r, color_bg.g, color_bg.b, color_bg.a);
+        SDL_RenderClear(renderer);
+        arena.draw(renderer, area);
+
+        drawFont(renderer, "Arena " + std::to_string(side) + "x" + std::to_string(side), 10, 10, 16, {255, 255, 255, 255});
+        drawFont(renderer, "Alive: " + std::to_string(arena.getAliveCount()) + " / " + std::to_string(snakeCount), 10, 40, 16, {255, 255, 255, 255});
+        drawFont(renderer, "Tick: " + std::to_string(arena.getTick()) + "  " + std::to_string(tickCost) + " ms", 10, 70, 16, {255, 255, 255, 255});
+
+        auto duration = Duration(Clock::now() - stime);
+        auto delay = constants::FRAME_TIME - duration.count();
+        if (delay > 0) {
+            SDL_Delay(delay);
+        }
+        present();
+    }
+}
+
+// 观战墙：SpeedSnake --spectate [棋盘数]，每个棋盘是一局由AI操作的单人游戏，结束后过一会儿重新开始
+void runSpectator(int boardCount) {
+    SDL_SetWindowSize(window, constants::SPECTATOR_WINDOW_WIDTH, constants::SPECTATOR_WINDOW_HEIGHT);
+    SDL_SetWindowPosition(window, SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED);
+
+    std::vector<std::unique_ptr<snake::Round>> rounds;
+    std::vector<utils::Rng> pilots;
+    std::vector<int> restartTimers(boardCount, 0);
+    snake::SpectatorWall wall({0, 40, constants::SPECTATOR_WINDOW_WIDTH, constants::SPECTATOR_WINDOW_HEIGHT - 40});
+    uint64_t seed = std::random_device{}();
+    for (int i = 0; i < boardCount; i++) {
+        rounds.emplace_back(new snake::Round("Board " + std::to_string(i), 1, 5, seed + i));
+        rounds.back()->setIsPaused(false);
+        pilots.emplace_back(seed ^ (0x9E3779B97F4A7C15ull * (i + 1)));
+        wall.addBoard(rounds.back().get());
+    }
+
+    utils::Timer fpsTimer;
+    int frames = 0;
+    double fps = 0;
+    bool paused = false;
+
+    while(ctn){
+        SDL_Event event;
+        auto stime = Clock::now();
+
+        while (SDL_PollEvent(&event)) {
+            if (event.type == SDL_EVENT_QUIT) ctn = false;
+            else if (event.type == SDL_EVENT_KEY_DOWN) {
+                if (event.key.key == SDLK_ESCAPE) ctn = false;
+                else if (event.key.key == SDLK_P) paused = !paused;
+                else if (event.key.key == SDLK_F3) showDebug = !showDebug;
+            }
+        }
+
+        if (!paused) {
+            for (int i = 0; i < boardCount; i++) {
+                auto& round = *rounds[i];
+                if (round.getIsGameOver()) {
+                    if (++restartTimers[i] >= constants::SPECTATOR_RESTART_FRAMES) {
+                        restartTimers[i] = 0;
+                        round.toggleRestart();
+                        round.setIsPaused(false);
+                    }
+                    continue;
+                }
+                round.playerMove(snake::autopilot(round, pilots[i]));
+                round.update();
+                round.pollEvents();
+            }
+        }
+
+        SDL_SetRenderDrawColor(renderer, color_bg.r, color_bg.g, color_bg.b, color_bg.a);
+        SDL_RenderClear(renderer);
+        wall.draw(renderer);
+
+        frames++;
+        if (fpsTimer.elapsed() >= 1000.0f) {
+            fps = frames * 1000.0 / fpsTimer.elapsed();
+            frames = 0;
+            fpsTimer.reset();
+        }
+        auto& stats = wall.getStats();
+        drawFont(renderer, "Boards: " + std::to_string(stats.boards) + "  Updated: " + std::to_string(stats.dirtyBoards)
+            + "  Vertices: " + std::to_string(stats.vertices) + "  Build: " + std::to_string(stats.buildMs).substr(0, 5) + " ms  FPS: "
+            + std::to_string(static_cast<int>(fps + 0.5)), 10, 10, 16, {255, 255, 255, 255});
+        if (showDebug) drawDebugOverlay(renderer);
+
+        auto duration = Duration(Clock::now() - stime);
+        auto delay = constants::FRAME_TIME - duration.count();
+        if (delay > 0) {
+            SDL_Delay(delay);
+        }
+        present();
+    }
+}
+
+// 双人对战：SpeedSnake --versus host <端口> [延迟ms] [丢包%]
+//           SpeedSnake --versus join <地址> <端口> [延迟ms] [丢包%]
+// 主机控制1号蛇，加入方控制2号蛇。延迟和丢包加在自己发出的包上，用于测试。
+void runVersus(net::Transport& transport, int localPlayer, uint64_t seed) {
+    net::RollbackSession session(transport, localPlayer, seed);
+    auto& round = session.getRound();
+    std::string role = localPlayer == 0 ? "You are P1 (host)" : "You are P2";
+
+    while(ctn){
+        SDL_Event event;
+        auto stime = Clock::now();
+
+        while (SDL_PollEvent(&event)) {
+            if (event.type == SDL_EVENT_QUIT) ctn = false;
+            else if (event.type == SDL_EVENT_KEY_DOWN) {
+                switch (event.key.key) {
+                case SDLK_ESCAPE: ctn = false; break;
+                case SDLK_UP: session.setLocalInput(snake::Direction::NORTH); break;
+                case SDLK_DOWN: session.setLocalInput(snake::Direction::SOUTH); break;
+                case SDLK_LEFT: session.setLocalInput(snake::Direction::WEST); break;
+                case SDLK_RIGHT: session.setLocalInput(snake::Direction::EAST); break;
+                default: break;
+                }
+            }
+        }
+
+        session.update();
+
+        auto events = round.pollEvents();
+        if (events & snake::EVENT_GAME_OVER) audioEngine.play(audio::GAME_OVER);
+        else if (events & snake::EVENT_EAT) audioEngine.play(audio::EAT);
+
+        SDL_SetRenderDrawColor(renderer, color_bg.r, color_bg.g, color_bg.b, color_bg.a);
+        SDL_RenderClear(renderer);
+        round.draw(renderer);
+
+        auto& stats = session.getStats();
+        drawFont(renderer, role, 10, 10, 16, {255, 255, 255, 255});
+        drawFont(renderer, "P1: " + std::to_string(round.getPlayerScore(0)) + "  P2: " + std::to_string(round.getPlayerScore(1)), 10, 40, 24, {255, 255, 255, 255});
+        drawFont(renderer, "Tick " + std::to_string(session.getTick()) + "  predicted " + std::to_string(session.getPredictedTicks())
+            + "  rollbacks " + std::to_string(stats.rollbacks) + "  desyncs " + std::to_string(stats.desyncs), 10, 80, 16, {255, 255, 255, 255});
+        if (session.isFinished()) {
+            int winner = round.getWinner();
+            std::string result = winner < 0 ? "Draw" : winner == localPlayer ? "You Win" : "You Lose";
+            drawFont(renderer, result, constants::WINDOW_WIDTH / 2 - 60, constants::WINDOW_HEIGHT / 2 - 24, 48, {255, 255, 0, 255});
+        }
+
+        auto duration = Duration(Clock::now() - stime);
+        auto delay = constants::FRAME_TIME - duration.count();
+        if (delay > 0) {
+            SDL_Delay(delay);
+        }
+        present();
+    }
+}
+
+// 解析--versus的参数并完成握手，失败时返回非0
+int startVersus(int argc, char* argv[]) {
+    std::string mode = argc >= 3 ? argv[2] : "";
+    bool host = mode == "host";
+    int next = host ? 4 : 5;
+    if ((!host && mode != "join") || argc < next) {
+        std::cerr << "Usage: --versus host <port> [lagMs] [loss%] | --versus join <address> <port> [lagMs] [loss%]" << std::endl;
+        return 1;
+    }
+    int lagMs = argc > next ? std::atoi(argv[next]) : 0;
+    int loss = argc > next + 1 ? std::atoi(argv[next + 1]) : 0;
+
+    net::UdpTransport socket;
+    if (host ? !socket.open(static_cast<uint16_t>(std::atoi(argv[3])))
+             : !socket.open(0) || !socket.setPeer(argv[3], static_cast<uint16_t>(std::atoi(argv[4])))) {
+        return 1;
+    }
+    net::LaggyTransport laggy(socket, lagMs, lagMs / 4, loss, std::random_device{}());
+    net::Transport& transport = lagMs > 0 || loss > 0 ? static_cast<net::Transport&>(laggy) : socket;
+
+    uint64_t seed = (static_cast<uint64_t>(std::random_device{}()) << 32) | std::random_device{}();
+    std::cout << (host ? "Waiting for opponent..." : "Connecting...") << std::endl;
+    bool connected = host ? net::hostHandshake(transport, seed, 60000) : net::joinHandshake(transport, seed, 10000);
+    if (!connected) {
+        std::cerr << "Handshake timed out" << std::endl;
+        return 1;
+    }
+    utils::verbose = false;
+
+    windowInit();
+    runVersus(transport, host ? 0 : 1, seed);
+    windowDestroy();
+    return 0;
+}
+
+// 按键事件发生的时刻。SDL的时间戳以SDL_GetTicksNS为准，换算到Clock上
+Clock::time_point eventTime(const SDL_KeyboardEvent& key) {
+    Uint64 now = SDL_GetTicksNS();
+    return Clock::now() - std::chrono::nanoseconds(now > key.timestamp ? now - key.timestamp : 0);
+}
+
+// 打开关卡文件并换到round上，关卡文件用完即关闭
+bool loadLevelFile(snake::Round& round, const std::string& path) {
+    auto start = Clock::now();
+    snake::Level level;
+    if (!level.open(path)) {
+        return false;
+    }
+    if (!round.loadLevel(level)) {
+        return false;
+    }
+    std::cout << "Level " << level.getName() << " (" << level.getWidth() << "x" << level.getHeight() << ") switched in "
+        << std::chrono::duration<double, std::milli>(Clock::now() - start).count() << " ms" << std::endl;
+    return true;
 }
 
 int main(int argc, char* argv[]){
+    if (argc >= 2 && std::string(argv[1]) == "--versus-loopback") {
+        return net::runLoopbackTest(argc >= 3 ? std::atoi(argv[2]) : 100, argc >= 4 ? std::atoi(argv[3]) : 10, argc >= 5 ? std::atoi(argv[4]) : 5);
+    }
+    if (argc >= 2 && std::string(argv[1]) == "--versus") {
+        return startVersus(argc, argv);
+    }
+
     windowInit();
+
+    if (argc >= 2 && std::string(argv[1]) == "--arena") {
+        runArena(argc >= 3 ? std::max(1, std::atoi(argv[2])) : constants::ARENA_DEFAULT_SNAKES);
+        windowDestroy();
+        return 0;
+    }
+    if (argc >= 2 && std::string(argv[1]) == "--spectate") {
+        runSpectator(argc >= 3 ? std::max(1, std::atoi(argv[2])) : constants::SPECTATOR_DEFAULT_BOARDS);
+        windowDestroy();
+        return 0;
+    }
     //随机数初始化
     std::mt19937 gen(std::random_device{}());
     std::uniform_int_distribution<int> rand_grid(0, constants::GRID_NUMBER - 1);
@@ -159,9 +459,30 @@ int main(int argc, char* argv[]){
     CenteredLabel tipsLabel2(constants::WINDOW_WIDTH / 2, constants::WINDOW_HEIGHT / 2 + 300, "Press P to continue", {255, 255, 0, 255}, 24, "tipsLabel2");
     CenteredLabel tipsLabel3(constants::WINDOW_WIDTH / 2, constants::WINDOW_HEIGHT / 2 + 268, "Press R to restart", {255, 0, 0, 255}, 24, "tipsLabel3");
     CenteredLabel gameOverLabel(constants::WINDOW_WIDTH / 2, constants::WINDOW_HEIGHT / 2, "Game Over", {255, 0, 0, 255}, 48, "gameOverLabel");
+    CenteredLabel trappedLabel(constants::WINDOW_WIDTH / 2, 190, "Trapped!", {255, 128, 0, 255}, 24, "trappedLabel");
 
     snake::Round levelOne = snake::Round("Level 1", 1, 5);
 
+    // SpeedSnake --level <关卡文件>...：从第一个关卡开始，按L切换到下一个
+    std::vector<std::string> levelPaths;
+    size_t currentLevel = 0;
+    if (argc >= 3 && std::string(argv[1]) == "--level") {
+        for (int i = 2; i < argc; i++) levelPaths.push_back(argv[i]);
+        loadLevelFile(levelOne, levelPaths[0]);
+    }
+
+    // 每局结束时记下成绩，写盘在后台进行。已有的成绩也在后台读入，不推迟第一帧
+    results::Store resultStore;
+    resultStore.openInBackground("./results.dat");
+    auto bestText = [&resultStore]() {
+        if (resultStore.isLoading()) return std::string("Best: loading...");
+        auto best = resultStore.top(1);
+        return "Best: " + std::to_string(best.empty() ? 0 : best[0].score) + " (" + std::to_string(resultStore.size()) + " games"
+            + (resultStore.isOpen() ? ")" : ", not saved)");
+    };
+    std::string bestScore = bestText();
+    bool bestLoaded = false;
+
     int lastScore = levelOne.getScore();
     int currScore;
     auto scoreText = "Score: " + std::to_string(lastScore);
@@ -194,20 +515,51 @@ int main(int argc, char* argv[]){
                     levelOne.toggleRestart();
                     break;
 
+                case SDLK_BACKSPACE:
+                    // 回退约一秒
+                    levelOne.rewind(levelOne.getSpeed());
+                    break;
+
+                case SDLK_F5:
+                    levelOne.saveToFile("./quicksave.dat");
+                    break;
+
+                case SDLK_F9:
+                    levelOne.loadFromFile("./quicksave.dat");
+                    break;
+
+                case SDLK_F3:
+                    showDebug = !showDebug;
+                    break;
+
+                case SDLK_H:
+                    // 高速模式
+                    levelOne.setHighSpeed(!levelOne.getHighSpeed());
+                    std::cout << "High speed " << (levelOne.getHighSpeed() ? "on" : "off") << std::endl;
+                    break;
+
+                case SDLK_L:
+                    // 切换关卡
+                    if (!levelPaths.empty()) {
+                        currentLevel = (currentLevel + 1) % levelPaths.size();
+                        loadLevelFile(levelOne, levelPaths[currentLevel]);
+                    }
+                    break;
+
                 case SDLK_UP:
-                    levelOne.playerMove(snake::Direction::NORTH);
+                    levelOne.playerMoveAt(snake::Direction::NORTH, 0, eventTime(event.key));
                     break;
 
                 case SDLK_DOWN:
-                    levelOne.playerMove(snake::Direction::SOUTH);
+                    levelOne.playerMoveAt(snake::Direction::SOUTH, 0, eventTime(event.key));
                     break;
 
                 case SDLK_LEFT:
-                    levelOne.playerMove(snake::Direction::WEST);
+                    levelOne.playerMoveAt(snake::Direction::WEST, 0, eventTime(event.key));
                     break;
 
                 case SDLK_RIGHT:
-                    levelOne.playerMove(snake::Direction::EAST);
+                    levelOne.playerMoveAt(snake::Direction::EAST, 0, eventTime(event.key));
                     break;
 
                 default:
@@ -222,6 +574,25 @@ int main(int argc, char* argv[]){
         }
 
         levelOne.update();
+
+        // 成绩库读完后刷新一次最高分
+        if (!bestLoaded && !resultStore.isLoading()) {
+            bestLoaded = true;
+            bestScore = bestText();
+        }
+
+        // 音效
+        auto events = levelOne.pollEvents();
+        if (events & snake::EVENT_GAME_OVER) {
+            audioEngine.play(audio::GAME_OVER);
+            resultStore.add(results::makeRecord(levelOne));
+            bestScore = bestText();
+        }
+        else {
+            if (events & snake::EVENT_SPEED_UP) audioEngine.play(audio::SPEED_UP);
+            else if (events & snake::EVENT_EAT) audioEngine.play(audio::EAT);
+            if (events & snake::EVENT_TURN) audioEngine.play(audio::TURN);
+        }
         // 清屏
         SDL_SetRenderDrawColor(renderer, color_bg.r, color_bg.g, color_bg.b, color_bg.a);
         SDL_RenderClear(renderer);
@@ -252,6 +623,8 @@ int main(int argc, char* argv[]){
         // 显示暂停或游戏结束
         if (levelOne.getIsGameOver()) gameOverLabel.draw(renderer);
         else if (levelOne.getIsPaused()) pauseLabel.draw(renderer);
+        // 蛇已经把自己封死
+        if (!levelOne.getIsGameOver() && levelOne.isTrapped()) trappedLabel.draw(renderer);
 
         // 帧率
         auto duration = Duration(Clock::now() - stime);
@@ -274,10 +647,19 @@ int main(int argc, char* argv[]){
         }
 
         drawFont(renderer, "FPS: " + fps_str, 370, 10, 16, {255, 255, 255, 255});
+        if (showDebug) drawDebugOverlay(renderer);
+        else {
+            drawFont(renderer, bestScore, 10, 10, 16, {255, 255, 255, 255});
+            if (levelOne.getHighSpeed()) {
+                drawFont(renderer, "High speed: " + std::to_string(levelOne.getSpeed()) + " TPS, "
+                    + std::to_string(levelOne.getUpdateTicks()) + " ticks/frame", 10, 28, 16, {255, 128, 0, 255});
+            }
+        }
 
         // 显示渲染内容
-        SDL_RenderPresent(renderer);
+        present();
     }
+    resultStore.close();
     windowDestroy();
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,472 @@
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "netplay.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+
+namespace {
+#ifdef _WIN32
+    using SocketLength = int;
+    void closeSocket(intptr_t fd) { closesocket(static_cast<SOCKET>(fd)); }
+#else
+    using SocketLength = socklen_t;
+    void closeSocket(intptr_t fd) { close(static_cast<int>(fd)); }
+#endif
+
+    void sleepMs(int ms) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    }
+
+    uint32_t snapshotChecksum(const snake::Snapshot& snapshot) {
+        static thread_local std::vector<uint8_t> bytes;
+        bytes.clear();
+        snapshot.serialize(bytes);
+        return net::cellChecksum(bytes);
+    }
+}
+
+net::UdpTransport::~UdpTransport()
+{
+    if (fd != -1) closeSocket(fd);
+}
+
+bool net::UdpTransport::open(uint16_t localPort)
+{
+#ifdef _WIN32
+    static bool started = false;
+    if (!started) {
+        WSADATA data;
+        if (WSAStartup(MAKEWORD(2, 2), &data) != 0) {
+            std::cerr << "WSAStartup failed" << std::endl;
+            return false;
+        }
+        started = true;
+    }
+    SOCKET handle = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+    if (handle == INVALID_SOCKET) {
+        std::cerr << "socket failed: " << WSAGetLastError() << std::endl;
+        return false;
+    }
+    u_long nonBlocking = 1;
+    ioctlsocket(handle, FIONBIO, &nonBlocking);
+    fd = static_cast<intptr_t>(handle);
+#else
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        std::cerr << "socket failed: " << strerror(errno) << std::endl;
+        return false;
+    }
+    fcntl(static_cast<int>(fd), F_SETFL, fcntl(static_cast<int>(fd), F_GETFL) | O_NONBLOCK);
+#endif
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(localPort);
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        std::cerr << "bind to port " << localPort << " failed" << std::endl;
+        closeSocket(fd);
+        fd = -1;
+        return false;
+    }
+    return true;
+}
+
+bool net::UdpTransport::setPeer(const std::string& host, uint16_t port)
+{
+    addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo* result = nullptr;
+    if (getaddrinfo(host.c_str(), nullptr, &hints, &result) != 0 || !result) {
+        std::cerr << "Cannot resolve " << host << std::endl;
+        return false;
+    }
+    sockaddr_in addr;
+    std::memcpy(&addr, result->ai_addr, sizeof(addr));
+    freeaddrinfo(result);
+    addr.sin_port = htons(port);
+    std::memcpy(peer, &addr, sizeof(addr));
+    hasPeer = true;
+    return true;
+}
+
+void net::UdpTransport::send(const uint8_t* data, size_t size)
+{
+    if (fd == -1 || !hasPeer) return;
+    sendto(fd, reinterpret_cast<const char*>(data), static_cast<int>(size), 0,
+        reinterpret_cast<const sockaddr*>(peer), sizeof(sockaddr_in));
+}
+
+size_t net::UdpTransport::receive(uint8_t* buffer, size_t capacity)
+{
+    if (fd == -1) return 0;
+    sockaddr_in from;
+    SocketLength length = sizeof(from);
+    auto received = recvfrom(fd, reinterpret_cast<char*>(buffer), static_cast<int>(capacity), 0,
+        reinterpret_cast<sockaddr*>(&from), &length);
+    if (received <= 0) return 0;
+    if (!hasPeer) {
+        std::memcpy(peer, &from, sizeof(from));
+        hasPeer = true;
+    }
+    // 只接受对端发来的包
+    if (std::memcmp(peer, &from, sizeof(from)) != 0) return 0;
+    return static_cast<size_t>(received);
+}
+
+void net::LaggyTransport::send(const uint8_t* data, size_t size)
+{
+    if (rng.below(100) < static_cast<uint32_t>(lossPercent)) return;
+    int delay = latencyMs + (jitterMs > 0 ? static_cast<int>(rng.below(jitterMs + 1)) : 0);
+    Pending packet;
+    packet.due = Clock::now() + std::chrono::milliseconds(delay);
+    packet.data.assign(data, data + size);
+    // 保持按到期时间排序，抖动会让包乱序
+    auto position = std::upper_bound(pending.begin(), pending.end(), packet.due,
+        [](const Clock::time_point& due, const Pending& other) { return due < other.due; });
+    pending.insert(position, std::move(packet));
+    flush();
+}
+
+size_t net::LaggyTransport::receive(uint8_t* buffer, size_t capacity)
+{
+    flush();
+    return inner.receive(buffer, capacity);
+}
+
+void net::LaggyTransport::flush()
+{
+    auto now = Clock::now();
+    while (!pending.empty() && pending.front().due <= now) {
+        inner.send(pending.front().data.data(), pending.front().data.size());
+        pending.pop_front();
+    }
+}
+
+bool net::hostHandshake(Transport& transport, uint64_t seed, int timeoutMs)
+{
+    utils::Timer timer;
+    timer.reset();
+    uint8_t buffer[MAX_PACKET];
+    while (timer.elapsed() < timeoutMs) {
+        size_t size = transport.receive(buffer, sizeof(buffer));
+        if (size >= 1 && buffer[0] == MSG_HELLO) {
+            uint8_t start[9] = { MSG_START };
+            writeLE<uint64_t>(start + 1, seed);
+            transport.send(start, sizeof(start));
+            return true;
+        }
+        if (size == 0) sleepMs(1);
+    }
+    return false;
+}
+
+bool net::joinHandshake(Transport& transport, uint64_t& seed, int timeoutMs)
+{
+    utils::Timer timer, helloTimer;
+    timer.reset();
+    uint8_t buffer[MAX_PACKET];
+    bool first = true;
+    while (timer.elapsed() < timeoutMs) {
+        if (first || helloTimer.elapsed() >= 100) {
+            uint8_t hello = MSG_HELLO;
+            transport.send(&hello, 1);
+            helloTimer.reset();
+            first = false;
+        }
+        size_t size = transport.receive(buffer, sizeof(buffer));
+        if (size >= 9 && buffer[0] == MSG_START) {
+            seed = readLE<uint64_t>(buffer + 1);
+            return true;
+        }
+        if (size == 0) sleepMs(1);
+    }
+    return false;
+}
+
+net::RollbackSession::RollbackSession(Transport& transport, int localPlayer, uint64_t seed, int speed)
+    : transport(transport), localPlayer(localPlayer), seed(seed), round("Versus", 1, speed, seed, 2)
+{
+    std::memset(localInputs, NO_INPUT, sizeof(localInputs));
+    std::memset(remoteInputs, NO_INPUT, sizeof(remoteInputs));
+    std::memset(predictedInputs, NO_INPUT, sizeof(predictedInputs));
+    round.setIsPaused(false);
+    tickTimer.reset();
+    sendTimer.reset();
+}
+
+uint32_t net::RollbackSession::checksum() const
+{
+    snake::Snapshot snapshot;
+    round.saveSnapshot(snapshot);
+    return snapshotChecksum(snapshot);
+}
+
+void net::RollbackSession::update()
+{
+    receive();
+    if (rollbackFrom >= 0) resimulate();
+
+    bool advanced = false;
+    int tps = fixedTPS > 0 ? fixedTPS : round.getSpeed();
+    if (!round.getIsGameOver() && tickTimer.elapsed() >= 1000.0 / tps) {
+        if (tick - confirmedRemote >= MAX_ROLLBACK) {
+            // 对方太久没有消息，再预测下去回滚代价太大，等一等
+            if (!stalled) stats.stalls++;
+            stalled = true;
+        }
+        else {
+            stalled = false;
+            tickTimer.reset();
+            // 回滚可能让tick退回到已经发出输入的位置，这时沿用发出的输入
+            if (tick == localCount) {
+                localInputs[tick % HISTORY] = localInput;
+                localCount++;
+            }
+            simulate(tick);
+            tick++;
+            advanced = true;
+        }
+    }
+    updateChecksums();
+
+    // 推进了tick就立即发送；等待时也定期发送，让对方拿到确认
+    if (advanced || sendTimer.elapsed() >= 16) {
+        sendInputs();
+        sendTimer.reset();
+    }
+}
+
+uint8_t net::RollbackSession::remoteInputFor(int t) const
+{
+    if (t < confirmedRemote) return remoteInputs[t % HISTORY];
+    // 预测：对方保持最后一次确认的输入
+    if (confirmedRemote > 0) return remoteInputs[(confirmedRemote - 1) % HISTORY];
+    return NO_INPUT;
+}
+
+void net::RollbackSession::simulate(int t)
+{
+    round.saveSnapshot(snapshots[t % HISTORY]);
+    uint8_t inputs[2];
+    inputs[localPlayer] = localInputs[t % HISTORY];
+    inputs[1 - localPlayer] = predictedInputs[t % HISTORY] = remoteInputFor(t);
+    for (int player = 0; player < 2; player++) {
+        if (inputs[player] != NO_INPUT) round.playerMove(static_cast<snake::Direction>(inputs[player] & 3), player);
+    }
+    round.tick();
+}
+
+void net::RollbackSession::resimulate()
+{
+    auto start = Clock::now();
+    int from = rollbackFrom;
+    int end = tick;
+    rollbackFrom = -1;
+
+    round.loadSnapshot(snapshots[from % HISTORY]);
+    tick = from;
+    while (tick < end && !round.getIsGameOver()) {
+        simulate(tick);
+        tick++;
+    }
+    // 重算的tick已经播放过音效
+    round.pollEvents();
+
+    stats.rollbacks++;
+    stats.resimulatedTicks += end - from;
+    stats.maxRollback = std::max(stats.maxRollback, end - from);
+    stats.resimulateMs += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+void net::RollbackSession::receive()
+{
+    uint8_t buffer[MAX_PACKET];
+    while (true) {
+        size_t size = transport.receive(buffer, sizeof(buffer));
+        if (size == 0) break;
+
+        if (buffer[0] == MSG_HELLO && localPlayer == 0) {
+            // 加入方没收到START，再发一次
+            uint8_t start[9] = { MSG_START };
+            writeLE<uint64_t>(start + 1, seed);
+            transport.send(start, sizeof(start));
+            continue;
+        }
+        if (buffer[0] != MSG_INPUTS || size < 6) continue;
+        int first = static_cast<int>(readLE<uint32_t>(buffer + 1));
+        int count = buffer[5];
+        if (size < 6 + static_cast<size_t>(count) + 12) continue;
+
+        for (int i = 0; i < count; i++) {
+            int t = first + i;
+            // 只接受下一个需要的输入，旧的重复输入和有空缺的都跳过
+            if (t != confirmedRemote) continue;
+            // 不能覆盖回滚还可能用到的输入
+            if (t >= tick + HISTORY - MAX_ROLLBACK) break;
+            uint8_t input = buffer[6 + i];
+            remoteInputs[t % HISTORY] = input;
+            confirmedRemote++;
+            if (t < tick && predictedInputs[t % HISTORY] != input) {
+                rollbackFrom = rollbackFrom < 0 ? t : std::min(rollbackFrom, t);
+            }
+        }
+
+        const uint8_t* tail = buffer + 6 + count;
+        remoteAck = std::max(remoteAck, static_cast<int>(readLE<uint32_t>(tail)));
+        int sync = static_cast<int32_t>(readLE<uint32_t>(tail + 4));
+        if (sync > remoteSyncTick && sync > checkedTick) {
+            remoteSyncTick = sync;
+            remoteChecksum = readLE<uint32_t>(tail + 8);
+        }
+    }
+}
+
+void net::RollbackSession::updateChecksums()
+{
+    // 第t个tick开始时的状态只依赖t之前的输入，t <= confirmedRemote时就不会再变
+    int limit = std::min(confirmedRemote, tick - 1);
+    syncTick = std::max(syncTick, limit - HISTORY + MAX_ROLLBACK);
+    while (syncTick < limit) {
+        syncTick++;
+        checksums[syncTick % HISTORY] = snapshotChecksum(snapshots[syncTick % HISTORY]);
+    }
+
+    if (remoteSyncTick >= 0 && remoteSyncTick <= syncTick) {
+        if (remoteSyncTick > syncTick - HISTORY + MAX_ROLLBACK && checksums[remoteSyncTick % HISTORY] != remoteChecksum) {
+            stats.desyncs++;
+            std::cerr << "Desync at tick " << remoteSyncTick << std::endl;
+        }
+        checkedTick = remoteSyncTick;
+        remoteSyncTick = -1;
+    }
+}
+
+void net::RollbackSession::sendInputs()
+{
+    uint8_t packet[MAX_PACKET];
+    // 从对方还没确认的第一个输入开始重发，丢包时不需要重传机制
+    int first = std::max(remoteAck, localCount - HISTORY + MAX_ROLLBACK);
+    int count = std::min(localCount - first, 255);
+    if (count < 0) count = 0;
+
+    packet[0] = MSG_INPUTS;
+    writeLE<uint32_t>(packet + 1, static_cast<uint32_t>(first));
+    packet[5] = static_cast<uint8_t>(count);
+    for (int i = 0; i < count; i++) {
+        packet[6 + i] = localInputs[(first + i) % HISTORY];
+    }
+    uint8_t* tail = packet + 6 + count;
+    writeLE<uint32_t>(tail, static_cast<uint32_t>(confirmedRemote));
+    writeLE<uint32_t>(tail + 4, static_cast<uint32_t>(syncTick));
+    writeLE<uint32_t>(tail + 8, syncTick >= 0 ? checksums[syncTick % HISTORY] : 0);
+    transport.send(packet, 6 + count + 12);
+}
+
+namespace {
+    // 回环测试用的机器人：尽量不撞，偶尔随机转向
+    snake::Direction botMove(snake::Round& round, int player, utils::Rng& rng, bool suicide) {
+        auto snake = round.getSnake(player);
+        auto current = snake->head->direction;
+        if (suicide || snake->dead) return current;
+        // 下标即Direction：NORTH, WEST, SOUTH, EAST
+        static const int dx[4] = { 0, -1, 0, 1 };
+        static const int dy[4] = { -1, 0, 1, 0 };
+        snake::Direction safe[4];
+        int safeCount = 0;
+        for (int d = 0; d < 4; d++) {
+            if ((d + 2) % 4 == current) continue;
+            if (!round.getBoard().blocked(snake->head->x + dx[d], snake->head->y + dy[d])) {
+                safe[safeCount++] = static_cast<snake::Direction>(d);
+            }
+        }
+        if (safeCount == 0) return current;
+        for (int i = 0; i < safeCount; i++) {
+            if (safe[i] == current && rng.below(10) != 0) return current;
+        }
+        return safe[rng.below(safeCount)];
+    }
+}
+
+int net::runLoopbackTest(int latencyMs, int lossPercent, int matches)
+{
+    constexpr uint16_t PORT = 47700;
+    constexpr int TEST_TPS = 60;
+    constexpr int MAX_TICKS = 1500; // 超过后机器人直走撞墙，结束这一局
+
+    utils::verbose = false;
+    std::cout << "Loopback versus test: latency " << latencyMs << " ms, loss " << lossPercent << "%, "
+        << matches << " matches at " << TEST_TPS << " TPS" << std::endl;
+
+    int failures = 0;
+    RollbackSession::Stats total;
+    uint64_t totalTicks = 0;
+    for (int match = 0; match < matches; match++) {
+        UdpTransport socketA, socketB;
+        if (!socketA.open(PORT) || !socketB.open(PORT + 1)) return 1;
+        socketA.setPeer("127.0.0.1", PORT + 1);
+        socketB.setPeer("127.0.0.1", PORT);
+        LaggyTransport laggyA(socketA, latencyMs / 2, latencyMs / 8, lossPercent, 2 * match + 1);
+        LaggyTransport laggyB(socketB, latencyMs / 2, latencyMs / 8, lossPercent, 2 * match + 2);
+
+        uint64_t seed = 1000 + match;
+        RollbackSession host(laggyA, 0, seed), guest(laggyB, 1, seed);
+        host.setFixedTPS(TEST_TPS);
+        guest.setFixedTPS(TEST_TPS);
+        utils::Rng botA(seed * 3), botB(seed * 5);
+
+        utils::Timer timer;
+        timer.reset();
+        while (!(host.isFinished() && guest.isFinished()) && timer.elapsed() < 60000) {
+            host.setLocalInput(botMove(host.getRound(), 0, botA, host.getTick() > MAX_TICKS));
+            guest.setLocalInput(botMove(guest.getRound(), 1, botB, guest.getTick() > MAX_TICKS));
+            host.update();
+            guest.update();
+            laggyA.flush();
+            laggyB.flush();
+            sleepMs(1);
+        }
+
+        bool same = host.isFinished() && guest.isFinished() && host.getTick() == guest.getTick()
+            && host.checksum() == guest.checksum();
+        if (!same || host.getStats().desyncs || guest.getStats().desyncs) failures++;
+
+        for (auto session : { &host, &guest }) {
+            auto& stats = session->getStats();
+            total.rollbacks += stats.rollbacks;
+            total.resimulatedTicks += stats.resimulatedTicks;
+            total.resimulateMs += stats.resimulateMs;
+            total.stalls += stats.stalls;
+            total.desyncs += stats.desyncs;
+            total.maxRollback = std::max(total.maxRollback, stats.maxRollback);
+        }
+        totalTicks += host.getTick();
+        std::cout << "match " << match << ": ticks " << host.getTick() << "/" << guest.getTick()
+            << ", winner " << host.getRound().getWinner()
+            << ", rollbacks " << host.getStats().rollbacks << "/" << guest.getStats().rollbacks
+            << ", final state " << (same ? "identical" : "DIFFERENT") << std::endl;
+    }
+
+    std::cout << "ticks " << totalTicks << ", rollbacks " << total.rollbacks
+        << ", resimulated ticks " << total.resimulatedTicks
+        << " (avg " << (total.rollbacks ? double(total.resimulatedTicks) / total.rollbacks : 0.0)
+        << ", max " << total.maxRollback << ")"
+        << ", resimulate time " << total.resimulateMs << " ms"
+        << ", stalls " << total.stalls
+        << ", desyncs " << total.desyncs
+        << ", failed matches " << failures << std::endl;
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+// 双人对战的回滚网络同步：两端各自运行同一个Round，只交换每个tick的输入。
+// 对方的输入还没到时先按它上一次的输入预测，收到不一致的真实输入后从那个tick回滚重算。
+
+#include "utils.h"
+#include "protocol.h"
+
+#include <cstdint>
+#include <deque>
+#include <string>
+
+namespace net {
+    enum NetplayMessage : uint8_t {
+        MSG_HELLO = 0x10,  // 加入方 -> 主机，请求开始
+        MSG_START = 0x11,  // 主机 -> 加入方，u64 种子
+        MSG_INPUTS = 0x12, // u32 起始tick, u8 数量, 每个tick一个输入字节, u32 确认数, u32 校验tick, u32 校验值
+    };
+
+    constexpr uint8_t NO_INPUT = 0xFF; // 玩家还没有按过方向键
+
+    class Transport;
+    class UdpTransport;
+    class LaggyTransport;
+    class RollbackSession;
+
+    // 主机等待加入方并告知种子；加入方反复发送HELLO直到收到种子。超时返回false。
+    bool hostHandshake(Transport& transport, uint64_t seed, int timeoutMs);
+    bool joinHandshake(Transport& transport, uint64_t& seed, int timeoutMs);
+
+    // 无界面的回环自检：两个对端在同一进程内通过127.0.0.1对战，输出回滚统计和不同步次数
+    int runLoopbackTest(int latencyMs, int lossPercent, int matches);
+}
+
+// 不可靠的数据报通道，receive不阻塞，没有数据时返回0
+class net::Transport {
+public:
+    virtual ~Transport() {}
+    virtual void send(const uint8_t* data, size_t size) = 0;
+    virtual size_t receive(uint8_t* buffer, size_t capacity) = 0;
+};
+
+class net::UdpTransport : public Transport {
+public:
+    ~UdpTransport();
+
+    // 绑定本地端口，0表示由系统分配
+    bool open(uint16_t localPort);
+    // 指定对端地址；不指定时以第一个收到数据的地址为对端（主机）
+    bool setPeer(const std::string& host, uint16_t port);
+
+    void send(const uint8_t* data, size_t size) override;
+    size_t receive(uint8_t* buffer, size_t capacity) override;
+
+private:
+    intptr_t fd = -1;
+    uint8_t peer[16] = {}; // sockaddr_in
+    bool hasPeer = false;
+};
+
+// 包装另一个Transport，给发出的包加上延迟、抖动和丢包，用于测试
+class net::LaggyTransport : public Transport {
+public:
+    LaggyTransport(Transport& inner, int latencyMs, int jitterMs, int lossPercent, uint64_t seed)
+        : inner(inner), latencyMs(latencyMs), jitterMs(jitterMs), lossPercent(lossPercent), rng(seed) {}
+
+    void send(const uint8_t* data, size_t size) override;
+    size_t receive(uint8_t* buffer, size_t capacity) override;
+    // 把到时间的包交给inner
+    void flush();
+
+private:
+    struct Pending {
+        Clock::time_point due;
+        std::vector<uint8_t> data;
+    };
+    Transport& inner;
+    int latencyMs, jitterMs, lossPercent;
+    utils::Rng rng;
+    std::deque<Pending> pending;
+};
+
+class net::RollbackSession {
+public:
+    static constexpr int HISTORY = 64;      // 输入和快照的环形缓冲长度
+    static constexpr int MAX_ROLLBACK = 16; // 最多领先对方已确认输入的tick数，超过就等待
+
+    struct Stats {
+        uint64_t rollbacks = 0;
+        uint64_t resimulatedTicks = 0;
+        double resimulateMs = 0;
+        uint64_t stalls = 0;
+        uint64_t desyncs = 0;
+        int maxRollback = 0;
+    };
+
+    // localPlayer为0（主机）或1（加入方），两端使用相同的seed
+    RollbackSession(Transport& transport, int localPlayer, uint64_t seed, int speed = 5);
+
+    // 本地玩家的方向，从下一个tick开始生效
+    void setLocalInput(snake::Direction direction) { localInput = static_cast<uint8_t>(direction); }
+    // 固定tick速率（测试用），0表示跟随Round的速度
+    void setFixedTPS(int tps) { fixedTPS = tps; }
+
+    // 每帧调用：收包、按需回滚、到时间就推进一个tick，并发送输入
+    void update();
+
+    // 游戏结束且结束前的所有输入都已确认
+    bool isFinished() { return round.getIsGameOver() && confirmedRemote >= tick; }
+    snake::Round& getRound() { return round; }
+    int getLocalPlayer() const { return localPlayer; }
+    int getTick() const { return tick; }
+    // 领先对方已确认输入的tick数，即当前画面中预测的部分
+    int getPredictedTicks() const { return tick - confirmedRemote; }
+    const Stats& getStats() const { return stats; }
+    // tick开始时状态的校验值，用于比较两端
+    uint32_t checksum() const;
+
+private:
+    Transport& transport;
+    int localPlayer;
+    uint64_t seed;
+    snake::Round round;
+    int fixedTPS = 0;
+    utils::Timer tickTimer;
+    utils::Timer sendTimer;
+
+    int tick = 0;             // 已模拟的tick数
+    int localCount = 0;       // 已记录（并可能已发出）的本地输入数，回滚后不能再改
+    int confirmedRemote = 0;  // 已连续收到的对方输入数
+    int remoteAck = 0;        // 对方已连续收到的本地输入数
+    int rollbackFrom = -1;    // 需要从这个tick重算，-1表示不需要
+    uint8_t localInput = NO_INPUT;
+    bool stalled = false;
+
+    uint8_t localInputs[HISTORY];
+    uint8_t remoteInputs[HISTORY];
+    uint8_t predictedInputs[HISTORY]; // 模拟时使用的对方输入
+    snake::Snapshot snapshots[HISTORY]; // 第t个tick开始时的状态
+
+    int syncTick = -1;        // 已计算校验值的最后一个确定状态
+    uint32_t checksums[HISTORY];
+    int remoteSyncTick = -1;  // 对方发来的、还没有比较的校验
+    int checkedTick = -1;     // 已经比较过的最后一个校验
+    uint32_t remoteChecksum = 0;
+
+    Stats stats;
+
+    void receive();
+    void resimulate();
+    void simulate(int t); // 保存快照并模拟第t个tick
+    uint8_t remoteInputFor(int t) const;
+    void updateChecksums();
+    void sendInputs();
+};
@@ -0,0 +1,87 @@
+#include "protocol.h"
+
+namespace {
+    // 表示[0, count)中任意下标所需的位数
+    int indexBits(size_t count) {
+        int bits = 1;
+        while ((static_cast<size_t>(1) << bits) < count) bits++;
+        return bits;
+    }
+}
+
+// 格式：u16 变化数量，然后每个变化 = 下标(indexBits位) + 新值(2位)
+void net::encodeCellDelta(BitWriter& writer, const std::vector<uint8_t>& base, const std::vector<uint8_t>& cells)
+{
+    int bits = indexBits(cells.size());
+    uint32_t changed = 0;
+    for (size_t i = 0; i < cells.size(); i++) {
+        uint8_t old = base.empty() ? 0 : base[i];
+        if (old != cells[i]) changed++;
+    }
+    writer.write(changed, 16);
+    for (size_t i = 0; i < cells.size(); i++) {
+        uint8_t old = base.empty() ? 0 : base[i];
+        if (old != cells[i]) {
+            writer.write(static_cast<uint32_t>(i), bits);
+            writer.write(cells[i], 2);
+        }
+    }
+}
+
+bool net::decodeCellDelta(BitReader& reader, std::vector<uint8_t>& cells)
+{
+    int bits = indexBits(cells.size());
+    uint32_t changed;
+    if (!reader.read(changed, 16)) return false;
+    for (uint32_t i = 0; i < changed; i++) {
+        uint32_t index, value;
+        if (!reader.read(index, bits) || !reader.read(value, 2) || index >= cells.size()) {
+            return false;
+        }
+        cells[index] = static_cast<uint8_t>(value);
+    }
+    return true;
+}
+
+uint32_t net::cellChecksum(const std::vector<uint8_t>& cells)
+{
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for (auto cell : cells) {
+        hash ^= cell;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+bool net::ClientView::apply(const uint8_t* data, size_t size)
+{
+    if (size < SnapshotHeader::SIZE || data[0] != MSG_SNAPSHOT) return false;
+    SnapshotHeader incoming;
+    incoming.read(data);
+    // 乱序到达的旧帧直接丢弃
+    if (tick != NO_BASE && incoming.tick <= tick) return false;
+
+    std::vector<uint8_t> result;
+    if (incoming.baseTick == NO_BASE) {
+        result.assign(cells.size(), 0);
+    }
+    else {
+        int slot = incoming.baseTick % HISTORY;
+        if (frameTicks[slot] != incoming.baseTick) return false;
+        result = frames[slot];
+    }
+
+    BitReader reader(data + SnapshotHeader::SIZE, size - SnapshotHeader::SIZE);
+    if (!decodeCellDelta(reader, result) || cellChecksum(result) != incoming.checksum) {
+        return false;
+    }
+
+    int slot = incoming.tick % HISTORY;
+    frames[slot] = result;
+    frameTicks[slot] = incoming.tick;
+    cells.swap(result);
+    header = incoming;
+    tick = incoming.tick;
+    return true;
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 服务器与客户端之间的UDP协议，所有整数为小端
+namespace net {
+    enum MessageType : uint8_t {
+        // 客户端 -> 服务器
+        MSG_JOIN = 1,     // u16 房间号
+        MSG_INPUT = 2,    // u8 方向, u32 确认的tick
+        MSG_ACK = 3,      // u32 确认的tick
+        MSG_LEAVE = 4,
+        // 服务器 -> 客户端
+        MSG_WELCOME = 0x81,  // u16 房间号, u32 客户端id, u8 宽, u8 高
+        MSG_SNAPSHOT = 0x82, // SnapshotHeader + 比特打包的变化格子
+    };
+
+    constexpr uint32_t NO_BASE = 0xFFFFFFFF; // 没有可用的基准帧，相对空地图编码
+    constexpr size_t MAX_PACKET = 1200;
+
+    class BitWriter;
+    class BitReader;
+    struct SnapshotHeader;
+    class ClientView;
+
+    // 把cells相对base的变化写入writer，base为空时视为全0
+    void encodeCellDelta(BitWriter& writer, const std::vector<uint8_t>& base, const std::vector<uint8_t>& cells);
+    // 把变化应用到cells上（cells中应为基准帧）
+    bool decodeCellDelta(BitReader& reader, std::vector<uint8_t>& cells);
+    uint32_t cellChecksum(const std::vector<uint8_t>& cells);
+
+    template <typename T>
+    void writeLE(uint8_t* p, T value) {
+        for (size_t i = 0; i < sizeof(T); i++) p[i] = static_cast<uint8_t>(static_cast<uint64_t>(value) >> (i * 8));
+    }
+    template <typename T>
+    T readLE(const uint8_t* p) {
+        uint64_t value = 0;
+        for (size_t i = 0; i < sizeof(T); i++) value |= static_cast<uint64_t>(p[i]) << (i * 8);
+        return static_cast<T>(value);
+    }
+}
+
+struct net::SnapshotHeader {
+    static constexpr size_t SIZE = 1 + 4 + 4 + 2 + 1 + 1 + 4;
+
+    uint32_t tick = 0;
+    uint32_t baseTick = NO_BASE;
+    int16_t score = 0;
+    uint8_t TPS = 0;
+    uint8_t flags = 0; // bit0: 游戏结束
+    uint32_t checksum = 0; // 完整格子的校验，客户端用来确认解码正确
+
+    void write(uint8_t* p) const {
+        p[0] = MSG_SNAPSHOT;
+        writeLE<uint32_t>(p + 1, tick);
+        writeLE<uint32_t>(p + 5, baseTick);
+        writeLE<int16_t>(p + 9, score);
+        p[11] = TPS;
+        p[12] = flags;
+        writeLE<uint32_t>(p + 13, checksum);
+    }
+    void read(const uint8_t* p) {
+        tick = readLE<uint32_t>(p + 1);
+        baseTick = readLE<uint32_t>(p + 5);
+        score = readLE<int16_t>(p + 9);
+        TPS = p[11];
+        flags = p[12];
+        checksum = readLE<uint32_t>(p + 13);
+    }
+};
+
+class net::BitWriter {
+public:
+    std::vector<uint8_t> bytes;
+
+    void write(uint32_t value, int bits) {
+        for (int i = 0; i < bits; i++) {
+            if ((bitCount & 7) == 0) bytes.push_back(0);
+            if ((value >> i) & 1) bytes.back() |= 1 << (bitCount & 7);
+            bitCount += 1;
+        }
+    }
+    void clear() {
+        bytes.clear();
+        bitCount = 0;
+    }
+private:
+    size_t bitCount = 0;
+};
+
+class net::BitReader {
+public:
+    BitReader(const uint8_t* data, size_t size) : data(data), bitLimit(size * 8) {}
+
+    // 读越界时返回false
+    bool read(uint32_t& value, int bits) {
+        if (bitPos + bits > bitLimit) return false;
+        value = 0;
+        for (int i = 0; i < bits; i++) {
+            value |= static_cast<uint32_t>((data[bitPos >> 3] >> (bitPos & 7)) & 1) << i;
+            bitPos += 1;
+        }
+        return true;
+    }
+private:
+    const uint8_t* data;
+    size_t bitLimit;
+    size_t bitPos = 0;
+};
+
+// 客户端侧：保存最近收到的帧，按服务器指定的基准帧解码delta快照
+class net::ClientView {
+public:
+    static constexpr int HISTORY = 64;
+
+    std::vector<uint8_t> cells; // 最新一帧
+    SnapshotHeader header;      // 最新一帧的头
+    uint32_t tick = NO_BASE;    // 最新一帧的tick，也是要回给服务器的确认
+
+    void reset(size_t cellCount) {
+        cells.assign(cellCount, 0);
+        tick = NO_BASE;
+        for (int i = 0; i < HISTORY; i++) {
+            frameTicks[i] = NO_BASE;
+            frames[i].assign(cellCount, 0);
+        }
+    }
+    // 返回false表示数据损坏、基准帧已丢失或校验不一致
+    bool apply(const uint8_t* data, size_t size);
+
+private:
+    std::vector<uint8_t> frames[HISTORY];
+    uint32_t frameTicks[HISTORY];
+};
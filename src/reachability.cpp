@@ -0,0 +1,348 @@
+#include "reachability.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    int lowestBit(uint64_t word) {
+#if defined(__GNUC__) || defined(__clang__)
+        return __builtin_ctzll(word);
+#else
+        int bit = 0;
+        while (!(word & 1)) {
+            word >>= 1;
+            bit++;
+        }
+        return bit;
+#endif
+    }
+
+    // 对一行空闲位图中每个连续为1的段调用fn(begin, end)。超出宽度的位为0
+    template <typename F>
+    void forEachRun(const uint64_t* mask, int words, F&& fn) {
+        int begin = 0;
+        bool inside = false;
+        for (int w = 0; w < words; w++) {
+            // 与前一位不同的位置依次是段的开始和结束
+            uint64_t changes = mask[w] ^ ((mask[w] << 1) | (inside ? 1 : 0));
+            while (changes) {
+                int x = w * 64 + lowestBit(changes);
+                changes &= changes - 1;
+                if (!inside) begin = x;
+                else fn(begin, x);
+                inside = !inside;
+            }
+        }
+        if (inside) fn(begin, words * 64);
+    }
+}
+
+void snake::ReachabilityIndex::rebuild(const Board& board)
+{
+    width = board.width;
+    height = board.height;
+    stride = width + 2;
+    sizes.clear();
+    freeLabels.clear();
+    // 下面会重写每一行（含左右的墙），上下两行墙始终是NONE，尺寸不变时不用先清一遍
+    size_t total = static_cast<size_t>(width + 2) * (height + 2);
+    if (labels.size() != total) labels.assign(total, NONE);
+
+    // 大地图上逐格洪水填充太慢。先把每行压成空闲位图，再按行取出连续的空闲段：
+    // 与上一行的段重叠就属于同一区域，临时编号之间的等价关系记在并查集里（总是指向较小的编号）。
+    // 第一遍按顺序记下每段的临时编号，第二遍换成连续的区域编号、整行填写并统计大小
+    int words = (width + 63) / 64;
+    std::vector<uint64_t> freeMask(static_cast<size_t>(words) * height, 0);
+    for (int y = 0; y < height; y++) {
+        const uint8_t* row = &board.cells[board.index(0, y)];
+        uint64_t* mask = &freeMask[static_cast<size_t>(y) * words];
+        int x = 0;
+        // 一次处理8格：每个字节的BODY位和WALL位并到最低位，再用乘法收集到一个字节里（小端）
+        for (; x + 8 <= width; x += 8) {
+            uint64_t cells;
+            std::memcpy(&cells, row + x, 8);
+            uint64_t blocked = (cells | (cells >> 2)) & 0x0101010101010101ull;
+            uint64_t bits = ((blocked ^ 0x0101010101010101ull) * 0x0102040810204080ull) >> 56;
+            mask[x / 64] |= bits << (x % 64);
+        }
+        for (; x < width; x++) {
+            mask[x / 64] |= static_cast<uint64_t>((row[x] & (Board::BODY | Board::WALL)) == 0) << (x % 64);
+        }
+    }
+
+    struct Run {
+        int begin, end;
+        int32_t label;
+    };
+    std::vector<int32_t> parent, runLabels;
+    std::vector<Run> previous, current;
+    auto find = [&](int32_t label) {
+        while (parent[label] != label) label = parent[label] = parent[parent[label]];
+        return label;
+    };
+    for (int y = 0; y < height; y++) {
+        size_t above = 0;
+        forEachRun(&freeMask[static_cast<size_t>(y) * words], words, [&](int begin, int end) {
+            while (above < previous.size() && previous[above].end <= begin) above++;
+            int32_t label = NONE;
+            for (size_t i = above; i < previous.size() && previous[i].begin < end; i++) {
+                int32_t other = find(previous[i].label);
+                if (label == NONE) label = other;
+                else if (other < label) parent[label] = other, label = other;
+                else parent[other] = label;
+            }
+            if (label == NONE) {
+                label = static_cast<int32_t>(parent.size());
+                parent.push_back(label);
+            }
+            runLabels.push_back(label);
+            current.push_back({ begin, end, label });
+        });
+        std::swap(previous, current);
+        current.clear();
+    }
+
+    // parent[i] <= i，按顺序处理一遍后每个编号都直接指向根
+    std::vector<int32_t> regions(parent.size(), NONE);
+    for (size_t i = 0; i < parent.size(); i++) {
+        parent[i] = parent[parent[i]];
+        if (parent[i] == static_cast<int32_t>(i)) regions[i] = newLabel();
+    }
+    size_t run = 0;
+    for (int y = 0; y < height; y++) {
+        int32_t* out = &labels[index(0, y)];
+        int filled = -1;
+        forEachRun(&freeMask[static_cast<size_t>(y) * words], words, [&](int begin, int end) {
+            int32_t region = regions[parent[runLabels[run++]]];
+            std::fill(out + filled, out + begin, NONE);
+            std::fill(out + begin, out + end, region);
+            sizes[region] += end - begin;
+            filled = end;
+        });
+        std::fill(out + filled, out + width + 1, NONE);
+    }
+}
+
+int32_t snake::ReachabilityIndex::newLabel()
+{
+    int32_t label;
+    if (!freeLabels.empty()) {
+        label = freeLabels.back();
+        freeLabels.pop_back();
+    }
+    else {
+        label = static_cast<int32_t>(sizes.size());
+        sizes.push_back(0);
+    }
+    sizes[label] = 0;
+    return label;
+}
+
+void snake::ReachabilityIndex::releaseLabel(int32_t label)
+{
+    freeLabels.push_back(label);
+}
+
+int snake::ReachabilityIndex::relabel(int start, int32_t from, int32_t to)
+{
+    static thread_local std::vector<int> stack;
+    const int offsets[4] = { -stride, 1, stride, -1 };
+    stack.clear();
+    stack.push_back(start);
+    labels[start] = to;
+    int count = 0;
+    while (!stack.empty()) {
+        int cell = stack.back();
+        stack.pop_back();
+        count++;
+        for (int offset : offsets) {
+            int next = cell + offset;
+            if (labels[next] == from) {
+                labels[next] = to;
+                stack.push_back(next);
+            }
+        }
+    }
+    return count;
+}
+
+void snake::ReachabilityIndex::free(int x, int y)
+{
+    int cell = index(x, y);
+    if (labels[cell] != NONE) return;
+
+    const int offsets[4] = { -stride, 1, stride, -1 };
+    int32_t largest = NONE;
+    for (int offset : offsets) {
+        auto label = labels[cell + offset];
+        if (label != NONE && (largest == NONE || sizes[label] > sizes[largest])) largest = label;
+    }
+    if (largest == NONE) {
+        largest = newLabel();
+    }
+    labels[cell] = largest;
+    sizes[largest] += 1;
+
+    // 其余相邻区域并入最大的区域
+    for (int offset : offsets) {
+        auto label = labels[cell + offset];
+        if (label == NONE || label == largest) continue;
+        int moved = relabel(cell + offset, label, largest);
+        sizes[largest] += moved;
+        sizes[label] -= moved;
+        releaseLabel(label);
+    }
+}
+
+bool snake::ReachabilityIndex::ringConnected(int cell) const
+{
+    // 从北开始顺时针的一圈8个格子，偶数位置是上下左右
+    const int ring[8] = { -stride, -stride + 1, 1, stride + 1, stride, stride - 1, -1, -stride - 1 };
+    bool open[8];
+    int start = -1;
+    for (int i = 0; i < 8; i++) {
+        open[i] = labels[cell + ring[i]] != NONE;
+        if (!open[i] && start < 0) start = i;
+    }
+    if (start < 0) return true;
+
+    // 一圈中连续的空闲格子是连通的，包含上下左右格子的连续段只有一个时这些格子仍连通
+    int runs = 0;
+    bool inRun = false, runHasSide = false;
+    for (int k = 1; k <= 8; k++) {
+        int i = (start + k) % 8;
+        if (open[i]) {
+            if (!inRun) {
+                inRun = true;
+                runHasSide = false;
+            }
+            if (i % 2 == 0) runHasSide = true;
+        }
+        else if (inRun) {
+            if (runHasSide) runs++;
+            inRun = false;
+        }
+    }
+    return runs <= 1;
+}
+
+void snake::ReachabilityIndex::block(int x, int y)
+{
+    int cell = index(x, y);
+    auto label = labels[cell];
+    if (label == NONE) return;
+    labels[cell] = NONE;
+    sizes[label] -= 1;
+    if (sizes[label] == 0) {
+        releaseLabel(label);
+        return;
+    }
+
+    const int offsets[4] = { -stride, 1, stride, -1 };
+    int count = 0;
+    for (int offset : offsets) {
+        int next = cell + offset;
+        if (labels[next] == NONE) continue;
+        auto& search = searches[count];
+        search.cells.clear();
+        search.cells.push_back(next);
+        search.head = 0;
+        search.group = count;
+        count++;
+    }
+    if (count <= 1 || ringConnected(cell)) return;
+
+    // 从每个相邻格子同时BFS，每轮各扩展一个格子。两个搜索相遇就合并成一组，
+    // 一组的搜索全部结束时，它访问过的格子就是分裂出去的区域。
+    // 搜索i访问过的格子在labels中临时记为VISITED - i，没有分裂出去的最后改回label
+    for (int i = 0; i < count; i++) {
+        labels[searches[i].cells[0]] = VISITED - i;
+    }
+
+    bool finished[4] = {};
+    int groups = count;
+    while (groups > 1) {
+        for (int i = 0; i < count && groups > 1; i++) {
+            if (finished[i]) continue;
+            auto& search = searches[i];
+            if (search.head < search.cells.size()) {
+                int current = search.cells[search.head++];
+                for (int offset : offsets) {
+                    int next = current + offset;
+                    if (labels[next] == label) {
+                        labels[next] = VISITED - i;
+                        search.cells.push_back(next);
+                    }
+                    else if (labels[next] <= VISITED) {
+                        int other = searches[VISITED - labels[next]].group;
+                        if (other != search.group) {
+                            for (int j = 0; j < count; j++) {
+                                if (searches[j].group == other) searches[j].group = search.group;
+                            }
+                            groups--;
+                        }
+                    }
+                }
+                continue;
+            }
+
+            bool exhausted = true;
+            for (int j = 0; j < count; j++) {
+                if (searches[j].group == search.group && searches[j].head < searches[j].cells.size()) exhausted = false;
+            }
+            if (!exhausted) continue;
+
+            auto split = newLabel();
+            int group = search.group;
+            for (int j = 0; j < count; j++) {
+                if (searches[j].group != group) continue;
+                for (int visited : searches[j].cells) {
+                    labels[visited] = split;
+                }
+                sizes[split] += static_cast<int>(searches[j].cells.size());
+                finished[j] = true;
+            }
+            sizes[label] -= sizes[split];
+            groups--;
+        }
+    }
+    for (int j = 0; j < count; j++) {
+        if (finished[j]) continue;
+        for (int visited : searches[j].cells) {
+            labels[visited] = label;
+        }
+    }
+}
+
+bool snake::ReachabilityIndex::reachableFrom(int headX, int headY, int x, int y) const
+{
+    auto label = labels[index(x, y)];
+    if (label == NONE) return false;
+    int head = index(headX, headY);
+    const int offsets[4] = { -stride, 1, stride, -1 };
+    for (int offset : offsets) {
+        if (labels[head + offset] == label) return true;
+    }
+    return false;
+}
+
+int snake::ReachabilityIndex::regionSizeAround(int headX, int headY) const
+{
+    int head = index(headX, headY);
+    const int offsets[4] = { -stride, 1, stride, -1 };
+    int32_t seen[4];
+    int count = 0, total = 0;
+    for (int offset : offsets) {
+        auto label = labels[head + offset];
+        if (label == NONE) continue;
+        bool duplicate = false;
+        for (int i = 0; i < count; i++) {
+            if (seen[i] == label) duplicate = true;
+        }
+        if (duplicate) continue;
+        seen[count++] = label;
+        total += sizes[label];
+    }
+    return total;
+}
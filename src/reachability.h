@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace snake {
+    class Board;
+    class ReachabilityIndex;
+}
+
+// 空闲格子（不是蛇身也不是墙）的连通区域标号，随蛇头占用和蛇尾释放增量更新。
+// 释放格子时把相邻区域合并，小区域并入大区域；占用格子时先看周围一圈能否直接连通，
+// 不能才从各个相邻格子同时BFS，先搜完的一侧就是分裂出去的小区域，只重标这一侧。
+class snake::ReachabilityIndex {
+public:
+    static constexpr int32_t NONE = -1;
+
+    // 按board的蛇身和墙重新计算所有区域
+    void rebuild(const Board& board);
+    // 格子变为空闲 / 被占用，坐标不含墙
+    void free(int x, int y);
+    void block(int x, int y);
+
+    bool isFree(int x, int y) const { return labels[index(x, y)] != NONE; }
+    // 两个空闲格子是否连通
+    bool connected(int x1, int y1, int x2, int y2) const {
+        auto label = labels[index(x1, y1)];
+        return label != NONE && label == labels[index(x2, y2)];
+    }
+    int regionSize(int x, int y) const {
+        auto label = labels[index(x, y)];
+        return label == NONE ? 0 : sizes[label];
+    }
+    // 蛇头本身被占用，从蛇头出发能到达的是四个相邻格子所在的区域
+    bool reachableFrom(int headX, int headY, int x, int y) const;
+    int regionSizeAround(int headX, int headY) const;
+
+private:
+    int width = 0, height = 0, stride = 0;
+    std::vector<int32_t> labels;  // 含墙的扁平下标，与Board相同
+    std::vector<int> sizes;       // 每个区域的格子数
+    std::vector<int32_t> freeLabels;
+
+    // 分裂检测用的临时数据
+    struct Search {
+        std::vector<int> cells; // BFS顺序，也是该搜索访问过的所有格子
+        size_t head = 0;
+        int group = 0;
+    };
+    Search searches[4];
+    static constexpr int32_t VISITED = -2; //搜索中的格子，后面依次是-3、-4、-5
+
+    int index(int x, int y) const { return (y + 1) * stride + (x + 1); }
+    int32_t newLabel();
+    void releaseLabel(int32_t label);
+    // 从start开始把label为from的连通格子改为to，返回改动的格子数
+    int relabel(int start, int32_t from, int32_t to);
+    bool ringConnected(int cell) const;
+};
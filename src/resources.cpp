@@ -0,0 +1,170 @@
+#include "resources.h"
+
+#include <SDL3_image/SDL_image.h>
+#include <atomic>
+#include <iostream>
+
+namespace {
+    struct Counter {
+        std::atomic<int64_t> live{0};
+        std::atomic<int64_t> bytes{0};
+        std::atomic<uint64_t> created{0};
+
+        void add(int64_t size) {
+            live.fetch_add(1, std::memory_order_relaxed);
+            bytes.fetch_add(size, std::memory_order_relaxed);
+            created.fetch_add(1, std::memory_order_relaxed);
+        }
+        void remove(int64_t size) {
+            live.fetch_sub(1, std::memory_order_relaxed);
+            bytes.fetch_sub(size, std::memory_order_relaxed);
+        }
+    };
+
+    Counter counters[resources::CATEGORY_COUNT];
+
+    int64_t textureBytes(const SDL_Texture* texture) {
+        return static_cast<int64_t>(texture->w) * texture->h * SDL_BYTESPERPIXEL(texture->format);
+    }
+
+    // 用外部内存创建的表面不拥有像素
+    int64_t surfaceBytes(const SDL_Surface* surface) {
+        if (surface->flags & SDL_SURFACE_PREALLOCATED) return 0;
+        return static_cast<int64_t>(surface->pitch) * surface->h;
+    }
+
+    SDL_Texture* trackTexture(SDL_Texture* texture) {
+        if (texture) counters[resources::TEXTURE].add(textureBytes(texture));
+        return texture;
+    }
+
+    SDL_Surface* trackSurface(SDL_Surface* surface) {
+        if (surface) counters[resources::SURFACE].add(surfaceBytes(surface));
+        return surface;
+    }
+}
+
+const char* resources::categoryName(Category category)
+{
+    static const char* names[CATEGORY_COUNT] = { "texture", "surface", "font", "renderer" };
+    return names[category];
+}
+
+resources::Usage resources::usage(Category category)
+{
+    Usage result;
+    result.live = counters[category].live.load(std::memory_order_relaxed);
+    result.bytes = counters[category].bytes.load(std::memory_order_relaxed);
+    result.created = counters[category].created.load(std::memory_order_relaxed);
+    return result;
+}
+
+resources::Totals resources::totals()
+{
+    Totals result;
+    for (int i = 0; i < CATEGORY_COUNT; i++) {
+        result.usage[i] = usage(static_cast<Category>(i));
+    }
+    return result;
+}
+
+std::string resources::describe(Category category)
+{
+    auto current = usage(category);
+    std::string text = std::string(categoryName(category)) + " " + std::to_string(current.live);
+    if (category == TEXTURE || category == SURFACE) {
+        text += " (" + std::to_string((current.bytes + 1023) / 1024) + " KB)";
+    }
+    return text + ", " + std::to_string(current.created) + " created";
+}
+
+SDL_Texture* resources::createTexture(SDL_Renderer* renderer, SDL_PixelFormat format, SDL_TextureAccess access, int width, int height)
+{
+    return trackTexture(SDL_CreateTexture(renderer, format, access, width, height));
+}
+
+SDL_Texture* resources::createTextureFromSurface(SDL_Renderer* renderer, SDL_Surface* surface)
+{
+    return trackTexture(SDL_CreateTextureFromSurface(renderer, surface));
+}
+
+void resources::destroyTexture(SDL_Texture* texture)
+{
+    if (!texture) return;
+    counters[TEXTURE].remove(textureBytes(texture));
+    SDL_DestroyTexture(texture);
+}
+
+SDL_Surface* resources::createSurfaceFrom(int width, int height, SDL_PixelFormat format, void* pixels, int pitch)
+{
+    return trackSurface(SDL_CreateSurfaceFrom(width, height, format, pixels, pitch));
+}
+
+SDL_Surface* resources::renderText(TTF_Font* font, const std::string& text, SDL_Color color)
+{
+    return trackSurface(TTF_RenderText_Blended(font, text.c_str(), text.length(), color));
+}
+
+SDL_Surface* resources::loadImage(const char* path)
+{
+    return trackSurface(IMG_Load(path));
+}
+
+void resources::destroySurface(SDL_Surface* surface)
+{
+    if (!surface) return;
+    counters[SURFACE].remove(surfaceBytes(surface));
+    SDL_DestroySurface(surface);
+}
+
+TTF_Font* resources::openFont(SDL_IOStream* stream, bool closeio, float size)
+{
+    TTF_Font* font = TTF_OpenFontIO(stream, closeio, size);
+    if (font) counters[FONT].add(0);
+    return font;
+}
+
+void resources::closeFont(TTF_Font* font)
+{
+    if (!font) return;
+    counters[FONT].remove(0);
+    TTF_CloseFont(font);
+}
+
+SDL_Renderer* resources::createRenderer(SDL_Window* window)
+{
+    SDL_Renderer* renderer = SDL_CreateRenderer(window, NULL);
+    if (renderer) counters[RENDERER].add(0);
+    return renderer;
+}
+
+void resources::destroyRenderer(SDL_Renderer* renderer)
+{
+    if (!renderer) return;
+    counters[RENDERER].remove(0);
+    SDL_DestroyRenderer(renderer);
+}
+
+uint32_t resources::LeakDetector::check()
+{
+    frames++;
+    if (frames <= warmupFrames) return 0;
+    auto current = totals();
+    if (frames == warmupFrames + 1) {
+        baseline = current;
+        return 0;
+    }
+
+    uint32_t grown = 0;
+    for (int i = 0; i < CATEGORY_COUNT; i++) {
+        auto& before = baseline.usage[i];
+        auto& now = current.usage[i];
+        if (now.live - before.live <= tolerance) continue;
+        std::cerr << "Possible " << categoryName(static_cast<Category>(i)) << " leak: " << before.live << " -> " << now.live
+            << " live, " << before.bytes << " -> " << now.bytes << " bytes after " << frames << " frames" << std::endl;
+        before = now;
+        grown |= 1u << i;
+    }
+    reported |= grown;
+    return grown;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+// SDL纹理、表面、字体和渲染器都通过这里创建和销毁，按类别统计存活的数量和字节数。
+// 调试信息层（F3）显示这些数字；LeakDetector在预热后记录基线，之后数量持续增长就报告。
+
+#include <SDL3/SDL.h>
+#include <SDL3_ttf/SDL_ttf.h>
+#include <cstdint>
+#include <string>
+
+namespace resources {
+    enum Category { TEXTURE, SURFACE, FONT, RENDERER, CATEGORY_COUNT };
+
+    struct Usage {
+        int64_t live = 0;     // 存活的对象数
+        int64_t bytes = 0;    // 像素占用的字节数，字体和渲染器不计
+        uint64_t created = 0; // 累计创建的对象数
+    };
+    struct Totals {
+        Usage usage[CATEGORY_COUNT];
+    };
+
+    class LeakDetector;
+
+    const char* categoryName(Category category);
+    Usage usage(Category category);
+    Totals totals();
+    // 例如 "texture 12 (48 KB), 3504 created"
+    std::string describe(Category category);
+
+    // 以下与同名的SDL函数相同，只是多了统计。可以在任意线程调用
+    SDL_Texture* createTexture(SDL_Renderer* renderer, SDL_PixelFormat format, SDL_TextureAccess access, int width, int height);
+    SDL_Texture* createTextureFromSurface(SDL_Renderer* renderer, SDL_Surface* surface);
+    void destroyTexture(SDL_Texture* texture);
+    SDL_Surface* createSurfaceFrom(int width, int height, SDL_PixelFormat format, void* pixels, int pitch);
+    SDL_Surface* renderText(TTF_Font* font, const std::string& text, SDL_Color color);
+    SDL_Surface* loadImage(const char* path);
+    void destroySurface(SDL_Surface* surface);
+    TTF_Font* openFont(SDL_IOStream* stream, bool closeio, float size);
+    void closeFont(TTF_Font* font);
+    SDL_Renderer* createRenderer(SDL_Window* window);
+    void destroyRenderer(SDL_Renderer* renderer);
+}
+
+// 每帧调用check()。前warmupFrames帧只观察，之后记下各类存活数量作为基线；
+// 某类比基线多出tolerance以上时报告一次，并把基线提高到当前值，持续泄漏会不断报告。
+class resources::LeakDetector {
+public:
+    LeakDetector(int warmupFrames = 600, int tolerance = 32) : warmupFrames(warmupFrames), tolerance(tolerance) {}
+
+    // 返回这次报告增长的类别（1 << Category）
+    uint32_t check();
+    bool isWarmedUp() const { return frames > warmupFrames; }
+    const Totals& getBaseline() const { return baseline; }
+    uint32_t getReported() const { return reported; }
+
+private:
+    int warmupFrames, tolerance;
+    int frames = 0;
+    Totals baseline;
+    uint32_t reported = 0; // 报告过增长的类别
+};
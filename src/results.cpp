@@ -0,0 +1,463 @@
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "results.h"
+#include "utils.h"
+
+#include <algorithm>
+#include <ctime>
+
+namespace {
+    const char MAGIC[8] = { 'S', 'S', 'R', 'E', 'S', 'L', 'T', '1' };
+    constexpr uint32_t VERSION = 1;
+    constexpr size_t HEADER_SIZE = 16; // magic, u32 版本, u32 记录长度
+    constexpr size_t CHECKED_SIZE = 36;
+    constexpr size_t READ_RECORDS = 4096; // 打开时每次读入的记录数
+
+    template <typename T>
+    void put(uint8_t* out, T value) {
+        for (size_t i = 0; i < sizeof(T); i++) out[i] = static_cast<uint8_t>(static_cast<uint64_t>(value) >> (i * 8));
+    }
+    template <typename T>
+    T get(const uint8_t* p) {
+        uint64_t value = 0;
+        for (size_t i = 0; i < sizeof(T); i++) value |= static_cast<uint64_t>(p[i]) << (i * 8);
+        return static_cast<T>(value);
+    }
+
+    // 每次处理8字节的查表CRC32（slice-by-8），打开几百万条记录时校验不是瓶颈
+    struct CrcTable {
+        uint32_t entries[8][256];
+        CrcTable() {
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t crc = i;
+                for (int bit = 0; bit < 8; bit++) crc = crc & 1 ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+                entries[0][i] = crc;
+            }
+            for (uint32_t i = 0; i < 256; i++) {
+                for (int k = 1; k < 8; k++) entries[k][i] = (entries[k - 1][i] >> 8) ^ entries[0][entries[k - 1][i] & 0xFF];
+            }
+        }
+    };
+    const CrcTable crcTable;
+
+    uint32_t crc32(const uint8_t* data, size_t size) {
+        auto& t = crcTable.entries;
+        uint32_t crc = 0xFFFFFFFFu;
+        for (; size >= 8; data += 8, size -= 8) {
+            uint32_t low = get<uint32_t>(data) ^ crc, high = get<uint32_t>(data + 4);
+            crc = t[7][low & 0xFF] ^ t[6][(low >> 8) & 0xFF] ^ t[5][(low >> 16) & 0xFF] ^ t[4][low >> 24] ^
+                t[3][high & 0xFF] ^ t[2][(high >> 8) & 0xFF] ^ t[1][(high >> 16) & 0xFF] ^ t[0][high >> 24];
+        }
+        for (; size > 0; data++, size--) crc = t[0][(crc ^ *data) & 0xFF] ^ (crc >> 8);
+        return crc ^ 0xFFFFFFFFu;
+    }
+
+    bool syncFile(std::FILE* file) {
+        if (std::fflush(file) != 0) return false;
+#ifdef _WIN32
+        return _commit(_fileno(file)) == 0;
+#else
+        return fsync(fileno(file)) == 0;
+#endif
+    }
+
+    bool truncateFile(std::FILE* file, uint64_t size) {
+#ifdef _WIN32
+        return _chsize_s(_fileno(file), static_cast<__int64>(size)) == 0;
+#else
+        return ftruncate(fileno(file), static_cast<off_t>(size)) == 0;
+#endif
+    }
+}
+
+results::Record results::makeRecord(snake::Round& round, uint8_t flags)
+{
+    Record record;
+    record.seed = round.getSeed();
+    record.inputHash = round.getInputHash();
+    record.score = static_cast<uint32_t>(round.getScore());
+    record.ticks = round.getTick();
+    record.durationMs = round.getGameMillis();
+    record.length = static_cast<uint16_t>(round.getSnake(0)->length);
+    record.TPS = static_cast<uint8_t>(round.getSpeed());
+    record.flags = flags | (round.getRestored() ? RESTORED : 0);
+    record.finishedAt = static_cast<uint32_t>(std::time(nullptr));
+    return record;
+}
+
+void results::Store::encode(const Record& record, uint8_t* out)
+{
+    put<uint64_t>(out, record.seed);
+    put<uint64_t>(out + 8, record.inputHash);
+    put<uint32_t>(out + 16, record.score);
+    put<uint32_t>(out + 20, record.ticks);
+    put<uint32_t>(out + 24, record.durationMs);
+    put<uint16_t>(out + 28, record.length);
+    out[30] = record.TPS;
+    out[31] = record.flags;
+    put<uint32_t>(out + 32, record.finishedAt);
+    put<uint32_t>(out + CHECKED_SIZE, crc32(out, CHECKED_SIZE));
+}
+
+bool results::Store::decode(const uint8_t* data, Record& record)
+{
+    if (get<uint32_t>(data + CHECKED_SIZE) != crc32(data, CHECKED_SIZE)) return false;
+    record.seed = get<uint64_t>(data);
+    record.inputHash = get<uint64_t>(data + 8);
+    record.score = get<uint32_t>(data + 16);
+    record.ticks = get<uint32_t>(data + 20);
+    record.durationMs = get<uint32_t>(data + 24);
+    record.length = get<uint16_t>(data + 28);
+    record.TPS = data[30];
+    record.flags = data[31];
+    record.finishedAt = get<uint32_t>(data + 32);
+    return true;
+}
+
+bool results::Store::open(const std::string& path)
+{
+    close();
+    reset();
+    if (!load(path)) return false;
+    worker = std::thread([this] { workerLoop(); });
+    return true;
+}
+
+void results::Store::openInBackground(const std::string& path)
+{
+    close();
+    reset();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        loading = true;
+    }
+    worker = std::thread([this, path] {
+        bool ok = load(path);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!ok) std::cerr << path << ": results are kept in memory only" << std::endl;
+            loading = false;
+            // 加载期间结束的对局排在已有记录之后
+            for (auto& record : deferred) enqueue(record);
+            deferred.clear();
+        }
+        if (ok) workerLoop();
+    });
+}
+
+void results::Store::reset()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    queued.clear();
+    deferred.clear();
+    queuedRecords = durableRecords = 0;
+    syncRequested = false;
+    closing = false;
+    failed = false;
+}
+
+bool results::Store::load(const std::string& path)
+{
+    auto start = Clock::now();
+    this->path = path;
+    records.clear();
+    best.clear();
+    previousWithSeed.clear();
+    seedSlots.clear();
+    seedCount = 0;
+    stats = Stats();
+
+    // 先读入已有的记录。校验不通过的记录跳过；最后一条好记录之后的部分是崩溃时没写完的，稍后截掉
+    uint64_t fileSize = 0, validSize = 0;
+    bool exists = false;
+    if (auto input = std::fopen(path.c_str(), "rb")) {
+        exists = true;
+        uint8_t header[HEADER_SIZE];
+        size_t headerRead = std::fread(header, 1, HEADER_SIZE, input);
+        fileSize = headerRead;
+        // 短于文件头说明是建文件时崩溃的，当作空文件
+        if (headerRead == HEADER_SIZE) {
+            if (!std::equal(MAGIC, MAGIC + 8, header) || get<uint32_t>(header + 8) != VERSION ||
+                    get<uint32_t>(header + 12) != RECORD_SIZE) {
+                std::cerr << path << " is not a results file" << std::endl;
+                std::fclose(input);
+                return false;
+            }
+            validSize = HEADER_SIZE;
+            // 按文件长度预留索引，几百万条记录时避免反复扩容和rehash
+            std::fseek(input, 0, SEEK_END);
+            auto expected = static_cast<size_t>(std::max(0L, std::ftell(input) - static_cast<long>(HEADER_SIZE)) / RECORD_SIZE);
+            std::fseek(input, HEADER_SIZE, SEEK_SET);
+            records.reserve(expected);
+            previousWithSeed.reserve(expected);
+            reserveSeeds(expected);
+            std::vector<uint8_t> block(READ_RECORDS * RECORD_SIZE);
+            uint64_t badRun = 0; // 上一条好记录之后连续的坏记录
+            size_t got;
+            // 块长是记录长度的整数倍，只有文件末尾会读到不完整的记录
+            while ((got = std::fread(block.data(), 1, block.size(), input)) > 0) {
+                for (size_t offset = 0; offset + RECORD_SIZE <= got; offset += RECORD_SIZE) {
+                    Record record;
+                    if (!decode(&block[offset], record)) {
+                        badRun++;
+                        continue;
+                    }
+                    index(record);
+                    stats.skipped += badRun;
+                    badRun = 0;
+                    validSize = fileSize + offset + RECORD_SIZE;
+                }
+                fileSize += got;
+            }
+        }
+        std::fclose(input);
+    }
+
+    file = std::fopen(path.c_str(), exists ? "r+b" : "w+b");
+    if (!file) {
+        std::cerr << "Failed to open " << path << " for writing" << std::endl;
+        return false;
+    }
+    if (validSize < HEADER_SIZE) {
+        uint8_t header[HEADER_SIZE];
+        std::copy(MAGIC, MAGIC + 8, header);
+        put<uint32_t>(header + 8, VERSION);
+        put<uint32_t>(header + 12, RECORD_SIZE);
+        if (!truncateFile(file, 0) || std::fwrite(header, 1, HEADER_SIZE, file) != HEADER_SIZE || !syncFile(file)) {
+            std::cerr << "Failed to write " << path << std::endl;
+            std::fclose(file);
+            file = nullptr;
+            return false;
+        }
+        validSize = HEADER_SIZE;
+    }
+    else if (fileSize > validSize) {
+        // 上次写到一半就崩溃了，截掉不完整的尾部，之后的记录接在最后一条完整记录后面
+        if (!truncateFile(file, validSize) || !syncFile(file)) {
+            std::cerr << "Failed to truncate " << path << std::endl;
+            std::fclose(file);
+            file = nullptr;
+            return false;
+        }
+        stats.truncated = fileSize - validSize;
+        std::cerr << path << ": dropped " << stats.truncated << " bytes of incomplete records" << std::endl;
+    }
+    if (stats.skipped > 0) {
+        std::cerr << path << ": skipped " << stats.skipped << " corrupted records" << std::endl;
+    }
+    std::fseek(file, 0, SEEK_END);
+
+    queuedRecords = durableRecords = records.size();
+    stats.loadMs = Duration(Clock::now() - start).count();
+    if (utils::verbose) {
+        std::cout << path << ": " << records.size() << " results loaded in " << stats.loadMs << " ms" << std::endl;
+    }
+    return true;
+}
+
+bool results::Store::close()
+{
+    // 后台打开时file由后台线程设置，以线程是否还在为准；正在加载时要等加载完
+    if (worker.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            closing = true;
+        }
+        changed.notify_all();
+        worker.join();
+    }
+    if (!file) return true;
+    bool ok = !failed;
+    ok = std::fclose(file) == 0 && ok;
+    file = nullptr;
+    return ok;
+}
+
+void results::Store::add(const Record& record)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (loading) {
+        deferred.push_back(record);
+        return;
+    }
+    enqueue(record);
+}
+
+void results::Store::enqueue(const Record& record)
+{
+    index(record);
+    if (!file) return;
+    size_t offset = queued.size();
+    queued.resize(offset + RECORD_SIZE);
+    encode(record, &queued[offset]);
+    queuedRecords++;
+    if (queuedRecords - durableRecords >= SYNC_RECORDS) changed.notify_one();
+}
+
+bool results::Store::sync()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (loading || !file) return false;
+    uint64_t target = queuedRecords;
+    syncRequested = true;
+    changed.notify_one();
+    synced.wait(lock, [&] { return durableRecords >= target || failed; });
+    return !failed;
+}
+
+void results::Store::workerLoop()
+{
+    std::vector<uint8_t> bytes;
+    while (true) {
+        uint64_t target;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait_for(lock, std::chrono::milliseconds(SYNC_INTERVAL_MS), [this] {
+                return closing || syncRequested || queuedRecords - durableRecords >= SYNC_RECORDS;
+            });
+            syncRequested = false;
+            if (queued.empty()) {
+                if (closing) return;
+                continue;
+            }
+            bytes.swap(queued);
+            target = queuedRecords;
+        }
+
+        // 整批一次写入、一次fsync，写的时候add照常进行
+        bool ok = !failed && flush(bytes);
+        bytes.clear();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!ok && !failed) {
+                failed = true;
+                std::cerr << "Failed to write " << path << ", results are kept in memory only" << std::endl;
+            }
+            durableRecords = target;
+            if (ok) stats.syncs++;
+        }
+        synced.notify_all();
+    }
+}
+
+bool results::Store::flush(std::vector<uint8_t>& bytes)
+{
+    if (std::fwrite(bytes.data(), 1, bytes.size(), file) != bytes.size() || !syncFile(file)) return false;
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.bytesWritten += bytes.size();
+    return true;
+}
+
+bool results::Store::ranksAbove(uint32_t a, uint32_t b) const
+{
+    return records[a].score != records[b].score ? records[a].score > records[b].score : a < b;
+}
+
+void results::Store::index(const Record& record)
+{
+    auto id = static_cast<uint32_t>(records.size());
+    records.push_back(record);
+
+    reserveSeeds(seedCount + 1);
+    auto& slot = seedSlots[findSeed(record.seed)];
+    if (slot.last == NONE) {
+        slot.seed = record.seed;
+        seedCount++;
+    }
+    previousWithSeed.push_back(slot.last);
+    slot.last = id;
+
+    // 新记录的下标最大，同分时排在后面，所以只有分数更高才挤进已满的榜
+    if (best.size() < TOP_CAPACITY || ranksAbove(id, best.back())) {
+        auto position = std::upper_bound(best.begin(), best.end(), id, [this](uint32_t a, uint32_t b) { return ranksAbove(a, b); });
+        best.insert(position, id);
+        if (best.size() > TOP_CAPACITY) best.pop_back();
+    }
+}
+
+size_t results::Store::findSeed(uint64_t seed) const
+{
+    size_t mask = seedSlots.size() - 1;
+    // 种子可能是连续的整数，先打散再取高位
+    size_t position = static_cast<size_t>((seed * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+    while (seedSlots[position].last != NONE && seedSlots[position].seed != seed) {
+        position = (position + 1) & mask;
+    }
+    return position;
+}
+
+void results::Store::reserveSeeds(size_t count)
+{
+    if (count * 2 <= seedSlots.size()) return;
+    size_t capacity = 1024;
+    while (capacity < count * 2) capacity *= 2;
+    std::vector<SeedSlot> old(capacity);
+    old.swap(seedSlots);
+    for (auto& slot : old) {
+        if (slot.last != NONE) seedSlots[findSeed(slot.seed)] = slot;
+    }
+}
+
+std::vector<results::Record> results::Store::top(size_t n) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<Record> result;
+    if (loading) return result;
+    if (n <= best.size() || best.size() == records.size()) {
+        n = std::min(n, best.size());
+        result.reserve(n);
+        for (size_t i = 0; i < n; i++) result.push_back(records[best[i]]);
+        return result;
+    }
+    // 超出缓存的名次，只能对全部记录部分排序
+    n = std::min<size_t>(n, records.size());
+    std::vector<uint32_t> ids(records.size());
+    for (size_t i = 0; i < ids.size(); i++) ids[i] = static_cast<uint32_t>(i);
+    std::partial_sort(ids.begin(), ids.begin() + n, ids.end(), [this](uint32_t a, uint32_t b) { return ranksAbove(a, b); });
+    result.reserve(n);
+    for (size_t i = 0; i < n; i++) result.push_back(records[ids[i]]);
+    return result;
+}
+
+std::vector<results::Record> results::Store::bySeed(uint64_t seed) const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<Record> result;
+    if (loading || seedSlots.empty()) return result;
+    for (uint32_t id = seedSlots[findSeed(seed)].last; id != NONE; id = previousWithSeed[id]) {
+        result.push_back(records[id]);
+    }
+    return result;
+}
+
+uint64_t results::Store::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return loading ? 0 : records.size();
+}
+
+bool results::Store::isOpen() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return !loading && file != nullptr;
+}
+
+bool results::Store::isLoading() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return loading;
+}
+
+results::Store::Stats results::Store::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (loading) return Stats();
+    Stats result = stats;
+    result.records = records.size();
+    result.pending = queuedRecords - durableRecords;
+    return result;
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+// 对局成绩库：每局结束时追加一条定长记录，文件只追加不改写。
+// 记录先进入内存中的索引并排队，由后台线程批量写入，攒够一批或隔一段时间才fsync一次，游戏线程不等磁盘；
+// 崩溃时最多丢掉还没fsync的最后一批，打开时按校验和截掉写了一半的尾部；中间校验不通过的记录只跳过，不改动文件。
+// 内存中保留全部记录，另有按分数排好的前TOP_CAPACITY名和按种子串起来的链，排行榜和按种子查询都不扫描全部记录。
+//
+// 文件格式（小端）：
+//   0  "SSRESLT1"
+//   8  u32 版本, u32 记录长度
+//   之后每条记录40字节：
+//   0  u64 种子, 8 u64 输入哈希
+//   16 u32 分数, 20 u32 tick数, 24 u32 游戏时间ms
+//   28 u16 长度, 30 u8 结束时的TPS, 31 u8 标志
+//   32 u32 结束时间（Unix秒）, 36 u32 前36字节的CRC32
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace snake {
+    class Round;
+}
+
+namespace results {
+    enum Flag : uint8_t {
+        RESTORED = 1,  // 中途读过快照，不能只靠种子和输入重现
+        SIMULATED = 2, // AI批量模拟，不是玩家的对局
+    };
+
+    struct Record;
+    class Store;
+
+    // 取出round当前这一局（第一条蛇）的成绩，通常在EVENT_GAME_OVER之后调用
+    Record makeRecord(snake::Round& round, uint8_t flags = 0);
+}
+
+struct results::Record {
+    uint64_t seed = 0;
+    uint64_t inputHash = 0;
+    uint32_t score = 0;
+    uint32_t ticks = 0;
+    uint32_t durationMs = 0; // 按各tick的速度累计的游戏时间，与帧率和暂停无关
+    uint16_t length = 0;
+    uint8_t TPS = 0;
+    uint8_t flags = 0;
+    uint32_t finishedAt = 0;
+};
+
+class results::Store {
+public:
+    static constexpr size_t RECORD_SIZE = 40;
+    static constexpr size_t TOP_CAPACITY = 1024;  // 排行榜缓存的名次，更多时现场排序
+    static constexpr size_t SYNC_RECORDS = 256;   // 攒够这么多条记录fsync一次
+    static constexpr int SYNC_INTERVAL_MS = 1000; // 不够一批时最多隔这么久fsync一次
+
+    struct Stats {
+        uint64_t records = 0;   // 索引中的记录，包括还没写入的
+        uint64_t pending = 0;   // 已经排队、还没fsync的记录
+        uint64_t syncs = 0;     // fsync的次数
+        uint64_t bytesWritten = 0;
+        uint64_t truncated = 0; // 打开时截掉的尾部字节
+        uint64_t skipped = 0;   // 打开时跳过的中间的坏记录
+        double loadMs = 0;      // 打开时读取和建立索引的时间
+    };
+
+    ~Store() { close(); }
+
+    // 读入已有的记录并建立索引，文件不存在时新建。之后的add追加到文件末尾
+    bool open(const std::string& path);
+    // 与open相同，但读入和建立索引在后台线程中进行，立即返回，游戏启动时不等几百万条记录。
+    // 加载完成前查询看不到任何记录，add的记录先存着，完成后接在已有记录之后。
+    // 打开失败时原因输出到cerr，之后的成绩只留在内存中
+    void openInBackground(const std::string& path);
+    // 等待排队的记录写完并fsync，然后关闭文件。失败返回false
+    bool close();
+    bool isOpen() const;
+    bool isLoading() const;
+
+    // 加入索引并交给后台线程，不做任何IO，可以在多个线程中同时调用
+    void add(const Record& record);
+    // 等待此前add的记录全部落盘，还在后台加载时返回false
+    bool sync();
+
+    // 分数从高到低的前n条，同分时先记录的在前
+    std::vector<Record> top(size_t n) const;
+    // 某个种子的全部记录，最近的在前
+    std::vector<Record> bySeed(uint64_t seed) const;
+    uint64_t size() const;
+    Stats getStats() const;
+
+    static void encode(const Record& record, uint8_t* out);
+    // 校验和不对时返回false
+    static bool decode(const uint8_t* data, Record& record);
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    // 种子到这个种子最近一条记录的开放寻址表，线性探测，装载率不超过一半
+    struct SeedSlot {
+        uint64_t seed = 0;
+        uint32_t last = NONE; // 为NONE表示空位
+    };
+
+    std::FILE* file = nullptr;
+    std::string path;
+
+    // 索引，由mutex保护
+    mutable std::mutex mutex;
+    std::vector<Record> records;
+    std::vector<uint32_t> best;                       // 前TOP_CAPACITY名的下标，按名次排列
+    std::vector<uint32_t> previousWithSeed;           // 同一种子的上一条记录，没有为NONE
+    std::vector<SeedSlot> seedSlots;                  // 长度为2的幂
+    size_t seedCount = 0;
+
+    // 写入队列，也由mutex保护
+    std::thread worker;
+    std::condition_variable changed;
+    std::condition_variable synced;
+    std::vector<uint8_t> queued;  // 编码好、等待写入的记录
+    uint64_t queuedRecords = 0;   // 累计排队的记录
+    uint64_t durableRecords = 0;  // 累计已经fsync的记录
+    bool syncRequested = false;
+    bool closing = false;
+    bool failed = false;
+    bool loading = false;         // 后台打开还没完成，这时只有deferred可以访问
+    std::vector<Record> deferred; // 加载期间add的记录
+    Stats stats;
+
+    bool ranksAbove(uint32_t a, uint32_t b) const;
+    size_t findSeed(uint64_t seed) const; // 这个种子所在的位置，没有时为应当插入的空位
+    void reserveSeeds(size_t count);
+    void index(const Record& record);
+    void enqueue(const Record& record); // 加入索引和写入队列，调用时持有mutex
+    void reset();                       // 清空写入队列的状态，打开前调用
+    bool load(const std::string& path); // 读入记录、建立索引并打开文件用于追加
+    void workerLoop();
+    bool flush(std::vector<uint8_t>& bytes);
+};
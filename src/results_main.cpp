@@ -0,0 +1,153 @@
+// SpeedSnakeResults simulate <文件> [局数=10000] [线程数]  用AI模拟单人对局，把成绩追加进成绩库
+// SpeedSnakeResults bench <文件> [记录数=1000000]          追加随机成绩，测量写入吞吐量、查询延迟和重新打开的耗时
+// SpeedSnakeResults top <文件> [名次=10]                    排行榜
+// SpeedSnakeResults seed <文件> <种子>                      某个种子的全部成绩
+
+#include "utils.h"
+#include "results.h"
+#include "thread_pool.h"
+
+#include <atomic>
+#include <iomanip>
+#include <string>
+
+namespace {
+    constexpr int MAX_GAME_TICKS = 5000;
+
+    double millisSince(Clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+    }
+
+    void print(const results::Record& record) {
+        std::cout << "score " << record.score << ", length " << record.length << ", " << record.ticks << " ticks, "
+            << record.durationMs << " ms, TPS " << int(record.TPS) << ", seed " << std::hex << record.seed
+            << ", inputs " << record.inputHash << std::dec;
+        if (record.flags & results::RESTORED) std::cout << ", restored";
+        if (record.flags & results::SIMULATED) std::cout << ", simulated";
+        std::cout << std::endl;
+    }
+
+    int simulate(const std::string& path, int games, int threads) {
+        results::Store store;
+        if (!store.open(path)) return 1;
+        uint64_t first = store.size();
+        std::atomic<uint64_t> simulatedTicks{0};
+
+        auto start = Clock::now();
+        utils::ThreadPool pool(threads);
+        pool.parallelFor(games, [&](size_t begin, size_t end) {
+            for (size_t game = begin; game < end; game++) {
+                snake::Round round("Game", 1, 5, 0x5EED0000ull + first + game);
+                utils::Rng rng(first + game);
+                while (!round.getIsGameOver() && round.getTick() < MAX_GAME_TICKS) {
+                    round.playerMove(snake::autopilot(round, rng));
+                    round.tick();
+                }
+                simulatedTicks += round.getTick();
+                store.add(results::makeRecord(round, results::SIMULATED));
+            }
+        });
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        if (!store.close()) return 1;
+
+        std::cout << games << " games, " << simulatedTicks << " ticks in " << std::fixed << std::setprecision(2) << seconds
+            << " s, " << store.getStats().syncs << " fsyncs, " << store.size() << " results in " << path << std::endl;
+        return 0;
+    }
+
+    int bench(const std::string& path, uint64_t count) {
+        results::Store store;
+        if (!store.open(path)) return 1;
+        uint64_t first = store.size();
+
+        // 分数大致呈指数分布，和真实对局接近；种子有一半重复，使按种子查询有多条结果
+        utils::Rng rng(first + 1);
+        auto start = Clock::now();
+        for (uint64_t i = 0; i < count; i++) {
+            results::Record record;
+            record.seed = rng.below(static_cast<uint32_t>(std::min<uint64_t>(count / 2 + 1, UINT32_MAX)));
+            record.inputHash = (static_cast<uint64_t>(rng()) << 32) | rng();
+            uint32_t score = 0;
+            while (score < 200 && rng.below(100) < 93) score++;
+            record.score = score;
+            record.length = static_cast<uint16_t>(score + 3);
+            record.ticks = score * 40 + rng.below(200);
+            record.durationMs = record.ticks * 100;
+            record.TPS = static_cast<uint8_t>(std::min<uint32_t>(20, 5 + score / 5));
+            record.flags = results::SIMULATED;
+            store.add(record);
+        }
+        double addMs = millisSince(start);
+        start = Clock::now();
+        if (!store.sync()) return 1;
+        double syncMs = millisSince(start);
+
+        const int queries = 1000;
+        start = Clock::now();
+        size_t returned = 0;
+        for (int i = 0; i < queries; i++) returned += store.top(10).size();
+        double top10Us = millisSince(start) * 1000 / queries;
+        start = Clock::now();
+        for (int i = 0; i < queries; i++) returned += store.top(100).size();
+        double top100Us = millisSince(start) * 1000 / queries;
+        start = Clock::now();
+        for (int i = 0; i < queries; i++) returned += store.bySeed(rng.below(static_cast<uint32_t>(count / 2 + 1))).size();
+        double seedUs = millisSince(start) * 1000 / queries;
+        auto stats = store.getStats();
+        if (!store.close()) return 1;
+
+        results::Store reopened;
+        if (!reopened.open(path)) return 1;
+
+        std::cout << std::fixed << std::setprecision(3) << count << " results added in " << addMs << " ms ("
+            << std::setprecision(0) << count / std::max(addMs, 1e-3) * 1000 << "/s), final sync " << std::setprecision(3) << syncMs
+            << " ms, " << stats.syncs << " fsyncs, " << stats.bytesWritten << " bytes" << std::endl;
+        std::cout << "query: top 10 " << top10Us << " us, top 100 " << top100Us << " us, by seed " << seedUs << " us ("
+            << returned << " results)" << std::endl;
+        std::cout << "reopen " << reopened.size() << " results in " << reopened.getStats().loadMs << " ms" << std::endl;
+        return 0;
+    }
+
+    int top(const std::string& path, size_t count) {
+        results::Store store;
+        if (!store.open(path)) return 1;
+        auto start = Clock::now();
+        auto best = store.top(count);
+        double queryMs = millisSince(start);
+        for (size_t i = 0; i < best.size(); i++) {
+            std::cout << std::setw(4) << i + 1 << ". ";
+            print(best[i]);
+        }
+        std::cout << store.size() << " results, loaded in " << std::fixed << std::setprecision(3) << store.getStats().loadMs
+            << " ms, query " << queryMs << " ms" << std::endl;
+        return 0;
+    }
+
+    int seed(const std::string& path, uint64_t seed) {
+        results::Store store;
+        if (!store.open(path)) return 1;
+        auto found = store.bySeed(seed);
+        for (auto& record : found) print(record);
+        std::cout << found.size() << " of " << store.size() << " results" << std::endl;
+        return 0;
+    }
+}
+
+int main(int argc, char* argv[]){
+    utils::verbose = false;
+    std::string command = argc >= 2 ? argv[1] : "";
+    if (command == "simulate" && argc >= 3) {
+        return simulate(argv[2], argc >= 4 ? std::max(1, std::atoi(argv[3])) : 10000, argc >= 5 ? std::atoi(argv[4]) : 0);
+    }
+    if (command == "bench" && argc >= 3) {
+        return bench(argv[2], argc >= 4 ? std::max<uint64_t>(1, std::strtoull(argv[3], nullptr, 10)) : 1000000);
+    }
+    if (command == "top" && argc >= 3) {
+        return top(argv[2], argc >= 4 ? std::max(1, std::atoi(argv[3])) : 10);
+    }
+    if (command == "seed" && argc >= 4) {
+        return seed(argv[2], std::strtoull(argv[3], nullptr, 16));
+    }
+    std::cerr << "Usage: SpeedSnakeResults simulate <file> [games] [threads] | bench <file> [count] | top <file> [count] | seed <file> <hex seed>" << std::endl;
+    return 1;
+}
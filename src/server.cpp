@@ -0,0 +1,344 @@
+#include "server.h"
+
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+    constexpr auto CLIENT_TIMEOUT = std::chrono::seconds(10);
+
+    uint64_t addressKey(const sockaddr_in& addr) {
+        return (static_cast<uint64_t>(addr.sin_addr.s_addr) << 16) | addr.sin_port;
+    }
+
+    void updateMax(std::atomic<uint64_t>& target, uint64_t value) {
+        auto current = target.load(std::memory_order_relaxed);
+        while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {}
+    }
+}
+
+net::Room::Room(uint16_t id, uint64_t seed) : id(id), round("Room " + std::to_string(id), 1, 5, seed)
+{
+    nextTick = Clock::now();
+    for (int i = 0; i < HISTORY; i++) {
+        frameTicks[i] = NO_BASE;
+    }
+    recordFrame();
+}
+
+void net::Room::recordFrame()
+{
+    int slot = tick % HISTORY;
+    round.getCells(frames[slot]);
+    frameTicks[slot] = tick;
+}
+
+void net::Room::step()
+{
+    if (round.getIsGameOver()) {
+        // 结束约两秒后自动重新开始
+        if (++restartCountdown >= round.getSpeed() * 2) {
+            restartCountdown = 0;
+            round.toggleRestart();
+        }
+    }
+    else {
+        round.tick();
+    }
+    round.pollEvents();
+    tick += 1;
+    recordFrame();
+}
+
+size_t net::Room::buildSnapshot(const Client& client, uint8_t* out)
+{
+    static const std::vector<uint8_t> empty;
+    const auto& cells = frames[tick % HISTORY];
+
+    SnapshotHeader header;
+    header.tick = tick;
+    const std::vector<uint8_t>* base = &empty;
+    if (client.lastAck != NO_BASE && frameTicks[client.lastAck % HISTORY] == client.lastAck) {
+        header.baseTick = client.lastAck;
+        base = &frames[client.lastAck % HISTORY];
+    }
+    header.score = static_cast<int16_t>(round.getScore());
+    header.TPS = static_cast<uint8_t>(round.getSpeed());
+    header.flags = round.getIsGameOver() ? 1 : 0;
+    header.checksum = cellChecksum(cells);
+
+    writer.clear();
+    encodeCellDelta(writer, *base, cells);
+    size_t size = SnapshotHeader::SIZE + writer.bytes.size();
+    if (size > MAX_PACKET) {
+        // 截断的delta解不出来，只会让客户端校验失败；地图太大时宁可不发
+        if (!oversizeReported) {
+            std::cerr << "Room " << id << ": snapshot of " << size << " bytes exceeds " << MAX_PACKET
+                << " byte packet limit, not sent" << std::endl;
+            oversizeReported = true;
+        }
+        return 0;
+    }
+    header.write(out);
+    std::memcpy(out + SnapshotHeader::SIZE, writer.bytes.data(), writer.bytes.size());
+    return size;
+}
+
+net::Shard::~Shard()
+{
+    if (epfd >= 0) close(epfd);
+    if (fd >= 0) close(fd);
+}
+
+bool net::Shard::open()
+{
+    fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    if (fd < 0) {
+        std::cerr << "Shard " << index << ": socket failed: " << strerror(errno) << std::endl;
+        return false;
+    }
+    int bufferSize = 4 * 1024 * 1024;
+    setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+    setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &bufferSize, sizeof(bufferSize));
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        std::cerr << "Shard " << index << ": bind to port " << port << " failed: " << strerror(errno) << std::endl;
+        return false;
+    }
+
+    epfd = epoll_create1(0);
+    epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (epfd < 0 || epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &event) < 0) {
+        std::cerr << "Shard " << index << ": epoll failed: " << strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void net::Shard::run(const std::atomic<bool>& running)
+{
+    epoll_event events[8];
+    uint8_t buffer[MAX_PACKET];
+    auto lastSweep = Clock::now();
+
+    while (running.load(std::memory_order_relaxed)) {
+        // 睡到最近一个房间该tick的时候，最多10毫秒
+        auto now = Clock::now();
+        long timeout = 10;
+        for (auto& entry : rooms) {
+            auto wait = std::chrono::duration_cast<std::chrono::microseconds>(entry.second->nextTick - now).count();
+            timeout = std::min(timeout, std::max(0L, static_cast<long>((wait + 999) / 1000)));
+        }
+
+        int n = epoll_wait(epfd, events, 8, static_cast<int>(timeout));
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.fd != fd) continue;
+            while (true) {
+                sockaddr_in from;
+                socklen_t length = sizeof(from);
+                ssize_t received = recvfrom(fd, buffer, sizeof(buffer), 0, reinterpret_cast<sockaddr*>(&from), &length);
+                if (received <= 0) break;
+                stats.bytesReceived.fetch_add(received, std::memory_order_relaxed);
+                handlePacket(buffer, received, from);
+            }
+        }
+
+        now = Clock::now();
+        for (auto& entry : rooms) {
+            auto& room = *entry.second;
+            if (now < room.nextTick) continue;
+
+            auto due = room.nextTick;
+            room.step();
+            for (auto& client : room.clients) {
+                size_t size = room.buildSnapshot(client, sendBuffer);
+                if (size > 0) sendTo(client.addr, sendBuffer, size);
+            }
+
+            auto period = std::chrono::microseconds(1000000 / std::max(1, room.round.getSpeed()));
+            room.nextTick += period;
+            // 落后太多时不再追赶
+            if (room.nextTick < now) room.nextTick = now + period;
+
+            auto latency = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - due).count();
+            stats.ticks.fetch_add(1, std::memory_order_relaxed);
+            stats.clientTicks.fetch_add(room.clients.size(), std::memory_order_relaxed);
+            stats.tickMicros.fetch_add(latency, std::memory_order_relaxed);
+            updateMax(stats.maxTickMicros, latency);
+        }
+
+        if (now - lastSweep > std::chrono::seconds(1)) {
+            dropIdleClients(now);
+            lastSweep = now;
+        }
+    }
+}
+
+net::Room::Client* net::Shard::findClient(Room& room, const sockaddr_in& addr)
+{
+    for (auto& client : room.clients) {
+        if (addressKey(client.addr) == addressKey(addr)) return &client;
+    }
+    return nullptr;
+}
+
+void net::Shard::handlePacket(const uint8_t* data, size_t size, const sockaddr_in& from)
+{
+    if (size == 0) return;
+    auto key = addressKey(from);
+    auto now = Clock::now();
+
+    if (data[0] == MSG_JOIN) {
+        if (size < 3) return;
+        uint16_t roomId = readLE<uint16_t>(data + 1);
+        // 房间不属于这个分片
+        if (roomId % shardCount != index) return;
+
+        auto joined = clientRooms.find(key);
+        if (joined != clientRooms.end()) {
+            roomId = joined->second;
+        }
+        else {
+            auto& room = rooms[roomId];
+            if (!room) {
+                room.reset(new Room(roomId, (static_cast<uint64_t>(rng()) << 32) | rng()));
+                stats.rooms.fetch_add(1, std::memory_order_relaxed);
+            }
+            Room::Client client;
+            client.addr = from;
+            client.id = (static_cast<uint32_t>(index) << 24) | nextClientId++;
+            client.lastSeen = now;
+            room->clients.push_back(client);
+            clientRooms[key] = roomId;
+            stats.clients.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        auto& room = *rooms[roomId];
+        const auto& board = room.round.getBoard();
+        uint8_t welcome[9];
+        welcome[0] = MSG_WELCOME;
+        writeLE<uint16_t>(welcome + 1, roomId);
+        writeLE<uint32_t>(welcome + 3, findClient(room, from)->id);
+        welcome[7] = static_cast<uint8_t>(board.width);
+        welcome[8] = static_cast<uint8_t>(board.height);
+        sendTo(from, welcome, sizeof(welcome));
+        return;
+    }
+
+    auto joined = clientRooms.find(key);
+    if (joined == clientRooms.end()) return;
+    auto& room = *rooms[joined->second];
+    auto client = findClient(room, from);
+    if (!client) return;
+    client->lastSeen = now;
+
+    uint32_t ack = NO_BASE;
+    switch (data[0])
+    {
+    case MSG_INPUT:
+        if (size < 6) return;
+        // 只有第一个加入的客户端能控制蛇
+        if (client == &room.clients.front()) {
+            room.round.playerMove(static_cast<snake::Direction>(data[1] & 3));
+        }
+        ack = readLE<uint32_t>(data + 2);
+        break;
+
+    case MSG_ACK:
+        if (size < 5) return;
+        ack = readLE<uint32_t>(data + 1);
+        break;
+
+    case MSG_LEAVE:
+        removeClient(from);
+        return;
+
+    default:
+        return;
+    }
+
+    if (ack != NO_BASE && ack <= room.tick && (client->lastAck == NO_BASE || ack > client->lastAck)) {
+        client->lastAck = ack;
+    }
+}
+
+void net::Shard::removeClient(const sockaddr_in& addr)
+{
+    auto joined = clientRooms.find(addressKey(addr));
+    if (joined == clientRooms.end()) return;
+    auto roomId = joined->second;
+    clientRooms.erase(joined);
+
+    auto& clients = rooms[roomId]->clients;
+    clients.erase(std::remove_if(clients.begin(), clients.end(), [&](const Room::Client& client) {
+        return addressKey(client.addr) == addressKey(addr);
+    }), clients.end());
+    stats.clients.fetch_sub(1, std::memory_order_relaxed);
+
+    if (clients.empty()) {
+        rooms.erase(roomId);
+        stats.rooms.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+void net::Shard::dropIdleClients(Clock::time_point now)
+{
+    std::vector<sockaddr_in> idle;
+    for (auto& entry : rooms) {
+        for (auto& client : entry.second->clients) {
+            if (now - client.lastSeen > CLIENT_TIMEOUT) idle.push_back(client.addr);
+        }
+    }
+    for (auto& addr : idle) {
+        removeClient(addr);
+    }
+}
+
+void net::Shard::sendTo(const sockaddr_in& addr, const uint8_t* data, size_t size)
+{
+    ssize_t sent = sendto(fd, data, size, 0, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr));
+    if (sent > 0) stats.bytesSent.fetch_add(sent, std::memory_order_relaxed);
+}
+
+net::GameServer::GameServer(uint16_t basePort, int shardCount)
+{
+    if (shardCount <= 0) shardCount = std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 0; i < shardCount; i++) {
+        shards.emplace_back(new Shard(i, shardCount, static_cast<uint16_t>(basePort + i), stats));
+    }
+}
+
+net::GameServer::~GameServer()
+{
+    stop();
+}
+
+bool net::GameServer::start()
+{
+    for (auto& shard : shards) {
+        if (!shard->open()) return false;
+    }
+    running = true;
+    for (auto& shard : shards) {
+        threads.emplace_back([this, &shard] { shard->run(running); });
+    }
+    return true;
+}
+
+void net::GameServer::stop()
+{
+    running = false;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    threads.clear();
+}
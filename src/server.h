@@ -0,0 +1,112 @@
+#pragma once
+
+// 权威服务器：不创建窗口，只在服务器上运行Round并通过UDP广播delta快照。
+// 使用epoll，仅支持Linux。
+
+#include "utils.h"
+#include "protocol.h"
+
+#include <netinet/in.h>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace net {
+    struct ServerStats;
+    class Room;
+    class Shard;
+    class GameServer;
+}
+
+// 各分片共同累加的统计数据
+struct net::ServerStats {
+    std::atomic<uint64_t> ticks{0};
+    std::atomic<uint64_t> clientTicks{0};   // 每个tick的客户端数之和
+    std::atomic<uint64_t> bytesSent{0};
+    std::atomic<uint64_t> bytesReceived{0};
+    std::atomic<uint64_t> tickMicros{0};    // 从tick应到时刻到广播完成
+    std::atomic<uint64_t> maxTickMicros{0};
+    std::atomic<int> rooms{0};
+    std::atomic<int> clients{0};
+};
+
+class net::Room {
+public:
+    static constexpr int HISTORY = 64; // 保留的历史帧，客户端的确认超出范围时发完整快照
+
+    struct Client {
+        sockaddr_in addr;
+        uint32_t id;
+        uint32_t lastAck = NO_BASE;
+        Clock::time_point lastSeen;
+    };
+
+    uint16_t id;
+    snake::Round round;
+    std::vector<Client> clients; // 第一个客户端控制蛇，其余为观战
+    Clock::time_point nextTick;
+    uint32_t tick = 0; // 房间自己的tick，重新开始也不归零
+
+    Room(uint16_t id, uint64_t seed);
+    void step();
+    // 为client生成快照，返回字节数；超过MAX_PACKET时不生成，返回0
+    size_t buildSnapshot(const Client& client, uint8_t* out);
+
+private:
+    std::vector<uint8_t> frames[HISTORY];
+    uint32_t frameTicks[HISTORY];
+    int restartCountdown = 0;
+    bool oversizeReported = false;
+    BitWriter writer;
+
+    void recordFrame();
+};
+
+// 每个分片一个线程、一个UDP端口，负责房间号 % 分片数 == index 的房间
+class net::Shard {
+public:
+    Shard(int index, int shardCount, uint16_t port, ServerStats& stats)
+        : index(index), shardCount(shardCount), port(port), stats(stats), rng(std::random_device{}() + index) {}
+    ~Shard();
+
+    bool open();
+    void run(const std::atomic<bool>& running);
+
+private:
+    int index, shardCount;
+    uint16_t port;
+    ServerStats& stats;
+    int fd = -1;
+    int epfd = -1;
+
+    std::unordered_map<uint16_t, std::unique_ptr<Room>> rooms;
+    std::unordered_map<uint64_t, uint16_t> clientRooms; // 地址 -> 房间号
+    uint32_t nextClientId = 1;
+    utils::Rng rng; // 新房间的种子
+    uint8_t sendBuffer[MAX_PACKET];
+
+    void handlePacket(const uint8_t* data, size_t size, const sockaddr_in& from);
+    Room::Client* findClient(Room& room, const sockaddr_in& addr);
+    void removeClient(const sockaddr_in& addr);
+    void dropIdleClients(Clock::time_point now);
+    void sendTo(const sockaddr_in& addr, const uint8_t* data, size_t size);
+};
+
+class net::GameServer {
+public:
+    GameServer(uint16_t basePort, int shardCount);
+    ~GameServer();
+
+    bool start();
+    void stop();
+    ServerStats& getStats() { return stats; }
+    int getShardCount() const { return static_cast<int>(shards.size()); }
+
+private:
+    ServerStats stats;
+    std::vector<std::unique_ptr<Shard>> shards;
+    std::vector<std::thread> threads;
+    std::atomic<bool> running{false};
+};
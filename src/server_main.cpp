@@ -0,0 +1,178 @@
+// SpeedSnakeServer [--port 7777] [--shards N] [--bench-clients N] [--bench-rooms N] [--duration 秒]
+// --bench-clients会在本进程内启动N个回环客户端，用于测量每个客户端每tick的字节数和tick延迟。
+
+#include "server.h"
+
+#include <arpa/inet.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <csignal>
+#include <cstring>
+#include <string>
+
+namespace {
+    std::atomic<bool> interrupted{false};
+
+    // 回环测试客户端：加入房间、解码快照、回确认，偶尔改变方向
+    struct BenchClient {
+        int fd = -1;
+        uint16_t room = 0;
+        bool joined = false;
+        net::ClientView view;
+        Clock::time_point lastJoin;
+    };
+
+    struct BenchResult {
+        std::atomic<uint64_t> snapshots{0};
+        std::atomic<uint64_t> rejected{0};
+        std::atomic<uint64_t> fullSnapshots{0};
+    };
+
+    void runBenchClients(int clientCount, int roomCount, uint16_t basePort, int shardCount,
+            const std::atomic<bool>& running, BenchResult& result) {
+        std::vector<BenchClient> clients(clientCount);
+        int epfd = epoll_create1(0);
+        utils::Rng rng(12345);
+
+        for (int i = 0; i < clientCount; i++) {
+            auto& client = clients[i];
+            client.room = static_cast<uint16_t>(i % roomCount);
+            client.fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+            sockaddr_in addr = {};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            addr.sin_port = htons(basePort + client.room % shardCount);
+            connect(client.fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+
+            epoll_event event = {};
+            event.events = EPOLLIN;
+            event.data.u32 = i;
+            epoll_ctl(epfd, EPOLL_CTL_ADD, client.fd, &event);
+        }
+
+        std::vector<epoll_event> events(256);
+        uint8_t buffer[net::MAX_PACKET];
+        while (running.load(std::memory_order_relaxed)) {
+            auto now = Clock::now();
+            for (auto& client : clients) {
+                if (client.joined || now - client.lastJoin < std::chrono::seconds(1)) continue;
+                uint8_t join[3] = { net::MSG_JOIN };
+                net::writeLE<uint16_t>(join + 1, client.room);
+                send(client.fd, join, sizeof(join), 0);
+                client.lastJoin = now;
+            }
+
+            int n = epoll_wait(epfd, events.data(), static_cast<int>(events.size()), 10);
+            for (int i = 0; i < n; i++) {
+                auto& client = clients[events[i].data.u32];
+                while (true) {
+                    ssize_t size = recv(client.fd, buffer, sizeof(buffer), 0);
+                    if (size <= 0) break;
+                    if (buffer[0] == net::MSG_WELCOME && size >= 9) {
+                        client.view.reset(static_cast<size_t>(buffer[7]) * buffer[8]);
+                        client.joined = true;
+                        continue;
+                    }
+                    if (buffer[0] != net::MSG_SNAPSHOT || !client.joined) continue;
+
+                    result.snapshots.fetch_add(1, std::memory_order_relaxed);
+                    if (!client.view.apply(buffer, size)) {
+                        result.rejected.fetch_add(1, std::memory_order_relaxed);
+                        continue;
+                    }
+                    if (client.view.header.baseTick == net::NO_BASE) {
+                        result.fullSnapshots.fetch_add(1, std::memory_order_relaxed);
+                    }
+
+                    uint8_t reply[6];
+                    if (rng() % 8 == 0) {
+                        reply[0] = net::MSG_INPUT;
+                        reply[1] = static_cast<uint8_t>(rng() % 4);
+                        net::writeLE<uint32_t>(reply + 2, client.view.tick);
+                        send(client.fd, reply, 6, 0);
+                    }
+                    else {
+                        reply[0] = net::MSG_ACK;
+                        net::writeLE<uint32_t>(reply + 1, client.view.tick);
+                        send(client.fd, reply, 5, 0);
+                    }
+                }
+            }
+        }
+
+        for (auto& client : clients) {
+            uint8_t leave = net::MSG_LEAVE;
+            send(client.fd, &leave, 1, 0);
+            close(client.fd);
+        }
+        close(epfd);
+    }
+}
+
+int main(int argc, char* argv[]){
+    uint16_t port = 7777;
+    int shards = 0;
+    int benchClients = 0;
+    int benchRooms = 100;
+    int duration = 0;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string option = argv[i];
+        int value = std::atoi(argv[i + 1]);
+        if (option == "--port") port = static_cast<uint16_t>(value);
+        else if (option == "--shards") shards = value;
+        else if (option == "--bench-clients") benchClients = value;
+        else if (option == "--bench-rooms") benchRooms = std::max(1, value);
+        else if (option == "--duration") duration = value;
+        else std::cerr << "Unknown option: " << option << std::endl;
+    }
+    if (benchClients > 0 && duration == 0) duration = 10;
+
+    utils::verbose = false;
+    std::signal(SIGINT, [](int) { interrupted = true; });
+
+    net::GameServer server(port, shards);
+    if (!server.start()) {
+        return 1;
+    }
+    std::cout << "Server listening on UDP " << port << "-" << port + server.getShardCount() - 1
+        << " (" << server.getShardCount() << " shards)" << std::endl;
+
+    std::atomic<bool> benchRunning{true};
+    BenchResult benchResult;
+    std::thread benchThread;
+    if (benchClients > 0) {
+        benchThread = std::thread(runBenchClients, benchClients, benchRooms, port, server.getShardCount(),
+            std::cref(benchRunning), std::ref(benchResult));
+    }
+
+    // 每两秒输出一次统计
+    auto& stats = server.getStats();
+    auto start = Clock::now();
+    uint64_t lastTicks = 0, lastClientTicks = 0, lastBytes = 0, lastMicros = 0;
+    while (!interrupted && (duration == 0 || Clock::now() - start < std::chrono::seconds(duration))) {
+        std::this_thread::sleep_for(std::chrono::seconds(2));
+
+        uint64_t ticks = stats.ticks, clientTicks = stats.clientTicks, bytes = stats.bytesSent, micros = stats.tickMicros;
+        uint64_t dTicks = ticks - lastTicks, dClientTicks = clientTicks - lastClientTicks;
+        std::cout << "rooms " << stats.rooms << ", clients " << stats.clients
+            << ", ticks/s " << dTicks / 2
+            << ", bytes/client/tick " << (dClientTicks ? double(bytes - lastBytes) / dClientTicks : 0.0)
+            << ", tick latency avg " << (dTicks ? (micros - lastMicros) / dTicks : 0) << " us"
+            << ", max " << stats.maxTickMicros.exchange(0) << " us";
+        if (benchClients > 0) {
+            std::cout << ", snapshots " << benchResult.snapshots << " (full " << benchResult.fullSnapshots
+                << ", rejected " << benchResult.rejected << ")";
+        }
+        std::cout << std::endl;
+        lastTicks = ticks;
+        lastClientTicks = clientTicks;
+        lastBytes = bytes;
+        lastMicros = micros;
+    }
+
+    benchRunning = false;
+    if (benchThread.joinable()) benchThread.join();
+    server.stop();
+    return 0;
+}
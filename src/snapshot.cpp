@@ -0,0 +1,292 @@
+#include "snapshot.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace {
+    // 与snake::Direction一致：NORTH, WEST, SOUTH, EAST
+    constexpr int DIR_DX[4] = { 0, -1, 0, 1 };
+    constexpr int DIR_DY[4] = { -1, 0, 1, 0 };
+
+    constexpr uint8_t SNAPSHOT_MAGIC[4] = { 'S', 'S', 'N', 'P' };
+    constexpr uint8_t SNAPSHOT_VERSION = 4;
+
+    template <typename T>
+    void writeLE(std::vector<uint8_t>& out, T value) {
+        for (size_t i = 0; i < sizeof(T); i++) {
+            out.push_back(static_cast<uint8_t>(static_cast<uint64_t>(value) >> (i * 8)));
+        }
+    }
+
+    template <typename T>
+    T readLE(const uint8_t* p) {
+        uint64_t value = 0;
+        for (size_t i = 0; i < sizeof(T); i++) {
+            value |= static_cast<uint64_t>(p[i]) << (i * 8);
+        }
+        return static_cast<T>(value);
+    }
+
+    // delta编码：第一个字节 = 蛇头方向(2) | 输入方向(2) | flags(4)，吃到苹果时追加14字节，变速时再追加1字节
+    void encodeDelta(std::vector<uint8_t>& out, const snake::TickDelta& delta) {
+        out.push_back(static_cast<uint8_t>(delta.headDirection | (delta.newDirection << 2) | (delta.flags << 4)));
+        if (delta.flags & snake::TickDelta::ATE) {
+            writeLE<uint16_t>(out, delta.appleIndex);
+            writeLE<int16_t>(out, delta.appleX);
+            writeLE<int16_t>(out, delta.appleY);
+            writeLE<uint64_t>(out, delta.rngState);
+        }
+        if (delta.flags & snake::TickDelta::SPEED_UP) {
+            out.push_back(delta.TPS);
+        }
+    }
+
+    size_t decodeDelta(const uint8_t* p, snake::TickDelta& delta) {
+        delta.headDirection = p[0] & 3;
+        delta.newDirection = (p[0] >> 2) & 3;
+        delta.flags = p[0] >> 4;
+        size_t size = 1;
+        if (delta.flags & snake::TickDelta::ATE) {
+            delta.appleIndex = readLE<uint16_t>(p + 1);
+            delta.appleX = readLE<int16_t>(p + 3);
+            delta.appleY = readLE<int16_t>(p + 5);
+            delta.rngState = readLE<uint64_t>(p + 7);
+            size = 15;
+        }
+        if (delta.flags & snake::TickDelta::SPEED_UP) {
+            delta.TPS = p[size++];
+        }
+        return size;
+    }
+}
+
+void snake::SnakeState::unpackBody(std::vector<uint8_t>& directions) const
+{
+    directions.resize(length);
+    for (int i = 0; i < length; i++) {
+        directions[i] = direction(i);
+    }
+}
+
+void snake::SnakeState::packBody(const std::vector<uint8_t>& directions)
+{
+    length = static_cast<uint16_t>(directions.size());
+    body.assign((length + 3) / 4, 0);
+    for (int i = 0; i < length; i++) {
+        body[i >> 2] |= (directions[i] & 3) << ((i & 3) * 2);
+    }
+}
+
+void snake::Snapshot::serialize(std::vector<uint8_t>& out) const
+{
+    out.assign(SNAPSHOT_MAGIC, SNAPSHOT_MAGIC + 4);
+    out.push_back(SNAPSHOT_VERSION);
+    writeLE<uint16_t>(out, width);
+    writeLE<uint16_t>(out, height);
+    writeLE<uint32_t>(out, walls);
+    writeLE<uint32_t>(out, tick);
+    writeLE<int16_t>(out, score);
+    out.push_back(TPS);
+    out.push_back(isGameOver ? 1 : 0);
+    writeLE<uint64_t>(out, rngState);
+    // 关卡最多65535个苹果
+    writeLE<uint16_t>(out, static_cast<uint16_t>(apples.size() / 2));
+    for (auto v : apples) {
+        writeLE<int16_t>(out, v);
+    }
+    out.push_back(static_cast<uint8_t>(snakes.size()));
+    for (const auto& snake : snakes) {
+        writeLE<int16_t>(out, snake.tailX);
+        writeLE<int16_t>(out, snake.tailY);
+        writeLE<uint16_t>(out, snake.length);
+        out.push_back(static_cast<uint8_t>(snake.newDirection | (snake.growing ? 4 : 0) | (snake.dead ? 8 : 0)));
+        writeLE<int16_t>(out, snake.score);
+        out.insert(out.end(), snake.body.begin(), snake.body.end());
+    }
+}
+
+bool snake::Snapshot::deserialize(const uint8_t* data, size_t size)
+{
+    constexpr size_t HEADER_SIZE = 4 + 1 + 2 + 2 + 4 + 4 + 2 + 1 + 1 + 8 + 2;
+    constexpr size_t SNAKE_HEADER_SIZE = 2 + 2 + 2 + 1 + 2;
+    if (size < HEADER_SIZE || std::equal(SNAPSHOT_MAGIC, SNAPSHOT_MAGIC + 4, data) == false ||
+            data[4] != SNAPSHOT_VERSION) {
+        return false;
+    }
+    const uint8_t* p = data + 5;
+    const uint8_t* end = data + size;
+    width = readLE<uint16_t>(p); p += 2;
+    height = readLE<uint16_t>(p); p += 2;
+    walls = readLE<uint32_t>(p); p += 4;
+    tick = readLE<uint32_t>(p); p += 4;
+    score = readLE<int16_t>(p); p += 2;
+    TPS = *p++;
+    isGameOver = (*p++ & 1) != 0;
+    rngState = readLE<uint64_t>(p); p += 8;
+
+    size_t appleCount = readLE<uint16_t>(p); p += 2;
+    if (static_cast<size_t>(end - p) < appleCount * 4 + 1) return false;
+    apples.resize(appleCount * 2);
+    for (auto& v : apples) {
+        v = readLE<int16_t>(p);
+        p += 2;
+    }
+
+    snakes.resize(*p++);
+    for (auto& snake : snakes) {
+        if (static_cast<size_t>(end - p) < SNAKE_HEADER_SIZE) return false;
+        snake.tailX = readLE<int16_t>(p); p += 2;
+        snake.tailY = readLE<int16_t>(p); p += 2;
+        snake.length = readLE<uint16_t>(p); p += 2;
+        snake.newDirection = *p & 3;
+        snake.growing = (*p & 4) != 0;
+        snake.dead = (*p & 8) != 0;
+        p++;
+        snake.score = readLE<int16_t>(p); p += 2;
+
+        size_t bodyBytes = (snake.length + 3) / 4;
+        if (snake.length < 2 || static_cast<size_t>(end - p) < bodyBytes) return false;
+        snake.body.assign(p, p + bodyBytes);
+        p += bodyBytes;
+    }
+    return p == end && !snakes.empty();
+}
+
+bool snake::writeSnapshotFile(const std::string& path, const Snapshot& snapshot)
+{
+    std::vector<uint8_t> bytes;
+    snapshot.serialize(bytes);
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "Failed to open save file: " << path << std::endl;
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    return static_cast<bool>(file);
+}
+
+bool snake::readSnapshotFile(const std::string& path, Snapshot& snapshot)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Failed to open save file: " << path << std::endl;
+        return false;
+    }
+    std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (!snapshot.deserialize(bytes.data(), bytes.size())) {
+        std::cerr << "Invalid save file: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void snake::TickDelta::apply(Snapshot& snapshot, std::vector<uint8_t>& directions) const
+{
+    auto& snake = snapshot.snakes[0];
+    if (flags & POP_TAIL) {
+        // 新蛇尾 = 旧蛇尾沿第二节的方向走一步
+        snake.tailX += DIR_DX[directions[1]];
+        snake.tailY += DIR_DY[directions[1]];
+        directions.erase(directions.begin());
+        directions[0] = directions.size() > 1 ? directions[1] : headDirection;
+    }
+    directions.push_back(headDirection);
+    snake.length = static_cast<uint16_t>(directions.size());
+    snake.growing = (flags & ATE) != 0;
+    snake.newDirection = newDirection;
+    if (flags & ATE) {
+        snapshot.score += 1;
+        snake.score += 1;
+        snapshot.apples[appleIndex * 2] = appleX;
+        snapshot.apples[appleIndex * 2 + 1] = appleY;
+        snapshot.rngState = rngState;
+    }
+    if (flags & SPEED_UP) {
+        snapshot.TPS = TPS;
+    }
+    snapshot.isGameOver = (flags & GAME_OVER) != 0;
+    snake.dead = snapshot.isGameOver;
+    snapshot.tick += 1;
+}
+
+size_t snake::RewindBuffer::segmentBytes(const Segment& segment)
+{
+    return sizeof(Segment) + segment.keyframe.snakes[0].body.size() +
+        segment.keyframe.apples.size() * sizeof(int16_t) + segment.deltas.size();
+}
+
+void snake::RewindBuffer::pushKeyframe(const Snapshot& snapshot)
+{
+    segments.emplace_back();
+    segments.back().keyframe = snapshot;
+    memoryUsed += segmentBytes(segments.back());
+
+    // 至少保留当前这一段
+    while (memoryUsed > memoryLimit && segments.size() > 1) {
+        memoryUsed -= segmentBytes(segments.front());
+        segments.pop_front();
+    }
+}
+
+void snake::RewindBuffer::pushDelta(const TickDelta& delta)
+{
+    if (segments.empty()) return;
+    auto& segment = segments.back();
+    size_t before = segment.deltas.size();
+    encodeDelta(segment.deltas, delta);
+    segment.count += 1;
+    memoryUsed += segment.deltas.size() - before;
+}
+
+size_t snake::RewindBuffer::replay(const Segment& segment, int n, Snapshot& out)
+{
+    out = segment.keyframe;
+    std::vector<uint8_t> directions;
+    out.snakes[0].unpackBody(directions);
+
+    size_t pos = 0;
+    TickDelta delta;
+    for (int i = 1; i < n; i++) {
+        pos += decodeDelta(segment.deltas.data() + pos, delta);
+        delta.apply(out, directions);
+    }
+    out.snakes[0].packBody(directions);
+    return pos;
+}
+
+bool snake::RewindBuffer::stepBack(int ticks, Snapshot& out)
+{
+    size_t total = size();
+    if (total <= 1 || ticks <= 0) return false;
+    if (static_cast<size_t>(ticks) > total - 1) ticks = static_cast<int>(total - 1);
+
+    while (ticks > 0) {
+        auto& segment = segments.back();
+        if (segment.count <= ticks) {
+            ticks -= segment.count;
+            memoryUsed -= segmentBytes(segment);
+            segments.pop_back();
+            continue;
+        }
+        Snapshot temp;
+        size_t before = segment.deltas.size();
+        segment.deltas.resize(replay(segment, segment.count - ticks, temp));
+        memoryUsed -= before - segment.deltas.size();
+        segment.count -= ticks;
+        ticks = 0;
+    }
+
+    replay(segments.back(), segments.back().count, out);
+    return true;
+}
+
+size_t snake::RewindBuffer::size() const
+{
+    size_t total = 0;
+    for (const auto& segment : segments) {
+        total += segment.count;
+    }
+    return total;
+}
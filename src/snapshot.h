@@ -0,0 +1,107 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace snake {
+    struct SnakeState; // 快照中的一条蛇
+    struct Snapshot;  // 一个tick结束时的完整对局状态
+    struct TickDelta; // 相邻两个tick之间的变化
+    class RewindBuffer;
+
+    bool writeSnapshotFile(const std::string& path, const Snapshot& snapshot);
+    bool readSnapshotFile(const std::string& path, Snapshot& snapshot);
+}
+
+// 蛇身只记录蛇尾坐标，以及从蛇尾到蛇头每一节的方向（2 bit，取值即Direction）。
+// 第k节的位置 = 第k-1节的位置 + 第k节的方向，所以20*20的地图蛇身最多100字节。
+struct snake::SnakeState {
+    int16_t tailX = 0, tailY = 0;
+    uint16_t length = 0;
+    uint8_t newDirection = 0; // 玩家已输入但还未生效的方向
+    bool growing = false;
+    bool dead = false;
+    int16_t score = 0;
+    std::vector<uint8_t> body;    // 每字节4节，低位在前
+
+    uint8_t direction(int i) const {
+        return (body[i >> 2] >> ((i & 3) * 2)) & 3;
+    }
+    void unpackBody(std::vector<uint8_t>& directions) const;
+    void packBody(const std::vector<uint8_t>& directions);
+};
+
+struct snake::Snapshot {
+    uint16_t width = 0, height = 0; // 地图尺寸和墙的校验和，与当前地图不同的快照不能读入
+    uint32_t walls = 0;
+    uint32_t tick = 0;
+    int16_t score = 0;  // 所有蛇吃到的苹果总数
+    uint8_t TPS = 0;
+    bool isGameOver = false;
+    uint64_t rngState = 0;
+    std::vector<int16_t> apples;  // x0, y0, x1, y1, ...
+    std::vector<SnakeState> snakes;
+
+    // 序列化为紧凑的字节流，用于存档
+    void serialize(std::vector<uint8_t>& out) const;
+    bool deserialize(const uint8_t* data, size_t size);
+};
+
+struct snake::TickDelta {
+    enum Flag : uint8_t { POP_TAIL = 1, ATE = 2, SPEED_UP = 4, GAME_OVER = 8 };
+
+    uint8_t headDirection = 0; // 新蛇头相对旧蛇头的方向
+    uint8_t newDirection = 0;
+    uint8_t flags = 0;
+    // 以下仅在ATE时有意义
+    uint16_t appleIndex = 0;
+    int16_t appleX = 0, appleY = 0;
+    uint64_t rngState = 0;
+    // 仅在SPEED_UP时有意义，关卡的速度曲线可以跳级或减速，所以记录变化后的值
+    uint8_t TPS = 0;
+
+    // 把delta应用到已解包的状态上，回放只用于单人模式，所以只涉及第一条蛇
+    void apply(Snapshot& snapshot, std::vector<uint8_t>& directions) const;
+};
+
+// 按tick记录的回放缓冲：每隔KEYFRAME_INTERVAL个tick存一个完整Snapshot，
+// 其余tick只存1字节（吃到苹果时15字节，同时变速再加1字节）的delta。超过内存上限时丢弃最旧的一段。
+class snake::RewindBuffer {
+public:
+    static constexpr int KEYFRAME_INTERVAL = 64;
+
+    explicit RewindBuffer(size_t memoryLimit = 256 * 1024) : memoryLimit(memoryLimit) {}
+
+    void clear() {
+        segments.clear();
+        memoryUsed = 0;
+    }
+    bool needsKeyframe() const {
+        return segments.empty() || segments.back().count >= KEYFRAME_INTERVAL;
+    }
+    void pushKeyframe(const Snapshot& snapshot);
+    void pushDelta(const TickDelta& delta);
+
+    // 丢弃最近的ticks个记录，并把回退后的最新状态写入out。没有可回退的记录时返回false。
+    bool stepBack(int ticks, Snapshot& out);
+
+    size_t size() const;
+    size_t getMemoryUsed() const { return memoryUsed; }
+
+private:
+    struct Segment {
+        Snapshot keyframe;
+        std::vector<uint8_t> deltas;
+        int count = 1; // 包括keyframe本身
+    };
+    std::deque<Segment> segments;
+    size_t memoryLimit;
+    size_t memoryUsed = 0;
+
+    static size_t segmentBytes(const Segment& segment);
+    // 从keyframe开始解码前n-1个delta，返回解码结束时在字节流中的位置
+    static size_t replay(const Segment& segment, int n, Snapshot& out);
+};
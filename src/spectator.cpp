@@ -0,0 +1,263 @@
+#include "spectator.h"
+#include "resources.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+    // 图集：每个精灵占8像素宽的一格，最大4x4
+    enum Sprite { SPRITE_WHITE, SPRITE_APPLE, SPRITE_HEAD, SPRITE_BODY, SPRITE_HEAD2, SPRITE_BODY2, SPRITE_COUNT };
+    constexpr int SPRITE_SLOT = 8;
+    constexpr int ATLAS_WIDTH = SPRITE_SLOT * SPRITE_COUNT;
+    constexpr int ATLAS_HEIGHT = 4;
+    const int spriteSize[SPRITE_COUNT] = { 4, 4, 2, 2, 2, 2 };
+
+    SDL_FRect spriteUV(Sprite sprite) {
+        return { float(sprite * SPRITE_SLOT) / ATLAS_WIDTH, 0,
+            float(spriteSize[sprite]) / ATLAS_WIDTH, float(spriteSize[sprite]) / ATLAS_HEIGHT };
+    }
+
+    SDL_FColor toFColor(SDL_Color color, float alpha = 1) {
+        return { color.r / 255.0f, color.g / 255.0f, color.b / 255.0f, color.a / 255.0f * alpha };
+    }
+
+    const SDL_FColor WHITE = { 1, 1, 1, 1 };
+
+    void addQuad(std::vector<SDL_Vertex>& out, float x, float y, float w, float h, Sprite sprite, SDL_FColor color = WHITE) {
+        auto uv = spriteUV(sprite);
+        out.push_back({ { x, y }, color, { uv.x, uv.y } });
+        out.push_back({ { x + w, y }, color, { uv.x + uv.w, uv.y } });
+        out.push_back({ { x + w, y + h }, color, { uv.x + uv.w, uv.y + uv.h } });
+        out.push_back({ { x, y + h }, color, { uv.x, uv.y + uv.h } });
+    }
+}
+
+snake::SpectatorWall::~SpectatorWall()
+{
+    if (atlas) resources::destroyTexture(atlas);
+}
+
+void snake::SpectatorWall::addBoard(Round* round)
+{
+    Slot slot;
+    slot.round = round;
+    slots.push_back(std::move(slot));
+    layoutDirty = true;
+}
+
+void snake::SpectatorWall::clear()
+{
+    slots.clear();
+    layoutDirty = true;
+}
+
+void snake::SpectatorWall::setArea(const SDL_FRect& area)
+{
+    this->area = area;
+    layoutDirty = true;
+}
+
+bool snake::SpectatorWall::createAtlas(SDL_Renderer* renderer)
+{
+    atlas = resources::createTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_STATIC, ATLAS_WIDTH, ATLAS_HEIGHT);
+    if (!atlas) {
+        std::cerr << "Failed to create spectator atlas: " << SDL_GetError() << std::endl;
+        return false;
+    }
+    SDL_SetTextureScaleMode(atlas, SDL_SCALEMODE_NEAREST);
+    SDL_SetTextureBlendMode(atlas, SDL_BLENDMODE_BLEND);
+
+    // 精灵和图集都是RGBA8888，逐行拷贝即可
+    std::vector<uint8_t> pixels(ATLAS_WIDTH * ATLAS_HEIGHT * 4, 0);
+    auto copySprite = [&](Sprite sprite, const uint8_t* source, int pitch) {
+        for (int y = 0; y < spriteSize[sprite]; y++) {
+            std::copy(source + y * pitch, source + y * pitch + spriteSize[sprite] * 4,
+                pixels.begin() + (y * ATLAS_WIDTH + sprite * SPRITE_SLOT) * 4);
+        }
+    };
+    const uint8_t white[16 * 4] = {
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+        255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255 };
+    copySprite(SPRITE_WHITE, white, 16);
+    copySprite(SPRITE_APPLE, snakeapple_pixel, 16);
+    copySprite(SPRITE_HEAD, snakehead_pixel, 8);
+    copySprite(SPRITE_BODY, snakebody_pixel, 8);
+    copySprite(SPRITE_HEAD2, snakehead2_pixel, 8);
+    copySprite(SPRITE_BODY2, snakebody2_pixel, 8);
+    SDL_UpdateTexture(atlas, nullptr, pixels.data(), ATLAS_WIDTH * 4);
+    return true;
+}
+
+void snake::SpectatorWall::layout()
+{
+    int count = static_cast<int>(slots.size());
+    if (count == 0) return;
+
+    // 选使每块最大的列数
+    int columns = 1;
+    float tile = 0;
+    for (int c = 1; c <= count; c++) {
+        int rows = (count + c - 1) / c;
+        float size = std::min(area.w / c, area.h / rows);
+        if (size > tile) {
+            tile = size;
+            columns = c;
+        }
+    }
+    float margin = std::max(2.0f, std::floor(tile * 0.05f));
+
+    for (int i = 0; i < count; i++) {
+        auto& slot = slots[i];
+        auto& board = slot.round->getBoard();
+        slot.width = board.width;
+        slot.height = board.height;
+        slot.mapVersion = slot.round->getMapVersion();
+        // 格子够大时取整，格线才不会有的粗有的细
+        float cell = std::min((tile - 2 * margin) / board.width, (tile - 2 * margin) / board.height);
+        slot.cellSize = cell >= 2 ? std::floor(cell) : cell;
+        float w = slot.cellSize * board.width, h = slot.cellSize * board.height;
+        float x = area.x + (i % columns) * tile, y = area.y + (i / columns) * tile;
+        slot.tile = { std::floor(x + (tile - w) / 2), std::floor(y + (tile - h) / 2), w, h };
+        slot.drawn = false;
+    }
+}
+
+void snake::SpectatorWall::buildStatic()
+{
+    staticVertices.clear();
+    auto background = toFColor(constants::color_gridbg);
+    auto line = toFColor(constants::color_gridline);
+    auto frame = toFColor(constants::color_frame);
+    for (auto& slot : slots) {
+        auto& tile = slot.tile;
+        float cell = slot.cellSize;
+        addQuad(staticVertices, tile.x, tile.y, tile.w, tile.h, SPRITE_WHITE, background);
+
+        // 格子太小时线会连成一片，与Round::drawGrid一样不画
+        if (cell >= 4) {
+            for (int i = 1; i < slot.width; i++) {
+                addQuad(staticVertices, tile.x + i * cell, tile.y, 1, tile.h, SPRITE_WHITE, line);
+            }
+            for (int i = 1; i < slot.height; i++) {
+                addQuad(staticVertices, tile.x, tile.y + i * cell, tile.w, 1, SPRITE_WHITE, line);
+            }
+        }
+
+        float thickness = std::max(1.0f, std::floor(constants::FRAME_THICKNESS * cell / constants::GRID_SIZE));
+        addQuad(staticVertices, tile.x - thickness, tile.y - thickness, tile.w + 2 * thickness, thickness, SPRITE_WHITE, frame);
+        addQuad(staticVertices, tile.x - thickness, tile.y + tile.h, tile.w + 2 * thickness, thickness, SPRITE_WHITE, frame);
+        addQuad(staticVertices, tile.x - thickness, tile.y, thickness, tile.h, SPRITE_WHITE, frame);
+        addQuad(staticVertices, tile.x + tile.w, tile.y, thickness, tile.h, SPRITE_WHITE, frame);
+
+        // 关卡里的墙，一行中连续的墙合成一个四边形
+        auto& board = slot.round->getBoard();
+        for (int y = 0; y < board.height; y++) {
+            const uint8_t* row = &board.cells[board.index(0, y)];
+            for (int x = 0; x < board.width;) {
+                if (!(row[x] & Board::WALL)) {
+                    x++;
+                    continue;
+                }
+                int begin = x;
+                while (x < board.width && (row[x] & Board::WALL)) x++;
+                addQuad(staticVertices, tile.x + begin * cell, tile.y + y * cell, (x - begin) * cell, cell, SPRITE_WHITE, frame);
+            }
+        }
+    }
+    stats.staticRebuilds++;
+}
+
+void snake::SpectatorWall::buildBoard(Slot& slot)
+{
+    auto& out = slot.vertices;
+    out.clear();
+    auto round = slot.round;
+    float cell = slot.cellSize;
+    // 精灵四周留出按比例缩放的间隙
+    float gap = constants::GAP * cell / constants::GRID_SIZE;
+    float size = cell - gap * 2;
+    auto place = [&](int x, int y, Sprite sprite) {
+        addQuad(out, slot.tile.x + x * cell + gap, slot.tile.y + y * cell + gap, size, size, sprite);
+    };
+
+    for (auto apple : round->getApples()) {
+        place(apple->grid_x, apple->grid_y, SPRITE_APPLE);
+    }
+    for (int i = 0; i < round->getPlayers(); i++) {
+        auto snake = round->getSnake(i);
+        bool second = snake->player != 0;
+        for (auto curr = snake->head->next; curr; curr = curr->next) {
+            place(curr->x, curr->y, second ? SPRITE_BODY2 : SPRITE_BODY);
+        }
+        place(snake->head->x, snake->head->y, second ? SPRITE_HEAD2 : SPRITE_HEAD);
+    }
+    if (round->getIsGameOver()) {
+        addQuad(out, slot.tile.x, slot.tile.y, slot.tile.w, slot.tile.h, SPRITE_WHITE, { 0, 0, 0, 0.6f });
+    }
+
+    slot.version = round->getVersion();
+    slot.drawn = true;
+}
+
+void snake::SpectatorWall::submit(SDL_Renderer* renderer, const std::vector<SDL_Vertex>& vertices)
+{
+    if (vertices.empty()) return;
+    size_t quads = vertices.size() / 4;
+    if (indices.size() < quads * 6) {
+        size_t first = indices.size() / 6;
+        indices.resize(quads * 6);
+        for (size_t q = first; q < quads; q++) {
+            int base = static_cast<int>(q * 4);
+            int* index = &indices[q * 6];
+            index[0] = base;
+            index[1] = base + 1;
+            index[2] = base + 2;
+            index[3] = base;
+            index[4] = base + 2;
+            index[5] = base + 3;
+        }
+    }
+    SDL_RenderGeometry(renderer, atlas, vertices.data(), static_cast<int>(vertices.size()), indices.data(), static_cast<int>(quads * 6));
+}
+
+void snake::SpectatorWall::draw(SDL_Renderer* renderer)
+{
+    if (!atlas && !createAtlas(renderer)) return;
+    auto start = Clock::now();
+
+    // 换了关卡的棋盘尺寸可能变化，整体重新排列
+    for (auto& slot : slots) {
+        auto& board = slot.round->getBoard();
+        if (slot.round->getMapVersion() != slot.mapVersion || board.width != slot.width || board.height != slot.height) {
+            layoutDirty = true;
+        }
+    }
+    if (layoutDirty) {
+        layout();
+        buildStatic();
+        layoutDirty = false;
+    }
+
+    int dirty = 0;
+    for (auto& slot : slots) {
+        if (slot.drawn && slot.version == slot.round->getVersion()) continue;
+        buildBoard(slot);
+        dirty++;
+    }
+    if (dirty) {
+        dynamicVertices.clear();
+        for (auto& slot : slots) {
+            dynamicVertices.insert(dynamicVertices.end(), slot.vertices.begin(), slot.vertices.end());
+        }
+    }
+
+    stats.boards = static_cast<int>(slots.size());
+    stats.dirtyBoards = dirty;
+    stats.vertices = staticVertices.size() + dynamicVertices.size();
+    stats.buildMs = Duration(Clock::now() - start).count();
+
+    submit(renderer, staticVertices);
+    submit(renderer, dynamicVertices);
+}
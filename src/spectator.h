@@ -0,0 +1,68 @@
+#pragma once
+
+// 观战墙：在一个窗口里平铺显示几十局同时进行的游戏。
+// 所有精灵放在一张图集里，所有棋盘的格子、线和墙合成一批顶点，蛇和苹果合成另一批，每帧只有两次绘制调用；
+// 静态的一批只在布局或地图变化时重建，动态的一批中只有状态变化过的棋盘重新生成顶点。
+
+#include "utils.h"
+
+#include <SDL3/SDL.h>
+#include <cstdint>
+#include <vector>
+
+namespace snake {
+    class SpectatorWall;
+}
+
+class snake::SpectatorWall {
+public:
+    struct Stats {
+        int boards = 0;
+        int dirtyBoards = 0;   // 上一帧重新生成顶点的棋盘
+        int staticRebuilds = 0; // 静态层累计重建次数
+        size_t vertices = 0;   // 上一帧提交的顶点数，两批合计
+        double buildMs = 0;    // 上一帧生成和拼接顶点的时间
+    };
+
+    explicit SpectatorWall(const SDL_FRect& area) : area(area) {}
+    ~SpectatorWall();
+    SpectatorWall(const SpectatorWall&) = delete;
+    SpectatorWall& operator=(const SpectatorWall&) = delete;
+
+    // 不持有round，round须比观战墙活得久。绘制和round的tick不能同时进行
+    void addBoard(Round* round);
+    void clear();
+    void setArea(const SDL_FRect& area);
+
+    void draw(SDL_Renderer* renderer);
+
+    const Stats& getStats() const { return stats; }
+
+private:
+    struct Slot {
+        Round* round = nullptr;
+        SDL_FRect tile = {};      // 棋盘在窗口中的区域，不含边框
+        float cellSize = 0;
+        uint32_t version = 0;
+        uint32_t mapVersion = 0;
+        int width = 0, height = 0;
+        bool drawn = false;       // 还没有生成过顶点
+        std::vector<SDL_Vertex> vertices; // 蛇、苹果和结束时的遮罩
+    };
+
+    SDL_FRect area;
+    std::vector<Slot> slots;
+    bool layoutDirty = true;
+
+    SDL_Texture* atlas = nullptr;
+    std::vector<SDL_Vertex> staticVertices;
+    std::vector<SDL_Vertex> dynamicVertices;
+    std::vector<int> indices; // 所有四边形共用的下标，按需要加长
+    Stats stats;
+
+    bool createAtlas(SDL_Renderer* renderer);
+    void layout();
+    void buildStatic();
+    void buildBoard(Slot& slot);
+    void submit(SDL_Renderer* renderer, const std::vector<SDL_Vertex>& vertices);
+};
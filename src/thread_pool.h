@@ -0,0 +1,96 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace utils {
+    class ThreadPool;
+}
+
+// 常驻的工作线程池，避免每个tick都创建线程
+class utils::ThreadPool {
+public:
+    explicit ThreadPool(int threads = 0) {
+        if (threads <= 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        for (int i = 0; i < threads; i++) {
+            workers.emplace_back([this] { workerLoop(); });
+        }
+    }
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        taskReady.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    int size() const {
+        return static_cast<int>(workers.size());
+    }
+
+    void submit(std::function<void()> task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.push(std::move(task));
+            pending += 1;
+        }
+        taskReady.notify_one();
+    }
+
+    // 等待所有已提交的任务完成
+    void wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        allDone.wait(lock, [this] { return pending == 0; });
+    }
+
+    // 把[0, count)切成若干块并行执行fn(begin, end)，返回时全部完成
+    void parallelFor(size_t count, const std::function<void(size_t, size_t)>& fn) {
+        if (count == 0) return;
+        size_t chunks = std::min(count, workers.size() * 4);
+        size_t chunkSize = (count + chunks - 1) / chunks;
+        for (size_t begin = 0; begin < count; begin += chunkSize) {
+            size_t end = std::min(count, begin + chunkSize);
+            submit([&fn, begin, end] { fn(begin, end); });
+        }
+        wait();
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable taskReady;
+    std::condition_variable allDone;
+    size_t pending = 0;
+    bool stopping = false;
+
+    void workerLoop() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                taskReady.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (stopping && tasks.empty()) return;
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+            task();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                pending -= 1;
+                if (pending == 0) allDone.notify_all();
+            }
+        }
+    }
+};
@@ -0,0 +1,240 @@
+#include "tournament.h"
+#include "protocol.h"
+#include "thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iomanip>
+
+namespace {
+    // 时间预算和用时统计用单调时钟，utils.h里的Clock在libstdc++上是system_clock，会被校时改动
+    using SteadyClock = std::chrono::steady_clock;
+
+    constexpr double ELO_K = 16;
+
+    constexpr long IDLE_WAIT_US = 1000000;
+
+    double microsSince(SteadyClock::time_point start) {
+        return std::chrono::duration<double, std::micro>(SteadyClock::now() - start).count();
+    }
+
+    // AI按顺序处理消息，收到PONG时之前的请求都已处理完，途中收到的旧回复丢弃。最多等IDLE_WAIT_US
+    void waitIdle(bot::BotProcess& process) {
+        uint8_t message[5], reply[64];
+        uint32_t sequence = process.nextSequence();
+        message[0] = bot::MSG_PING;
+        net::writeLE<uint32_t>(message + 1, sequence);
+        if (!process.channel().send(message, sizeof(message))) return;
+        auto deadline = SteadyClock::now() + std::chrono::microseconds(IDLE_WAIT_US);
+        while (true) {
+            long remaining = std::chrono::duration_cast<std::chrono::microseconds>(deadline - SteadyClock::now()).count();
+            long size = remaining > 0 ? process.channel().receive(reply, sizeof(reply), remaining) : 0;
+            if (size <= 0) return;
+            if (reply[0] == bot::MSG_PONG && size >= 5 && net::readLE<uint32_t>(reply + 1) == sequence) return;
+        }
+    }
+}
+
+bool bot::Tournament::measureRoundTrip(int count, std::vector<double>& samples)
+{
+    samples.clear();
+    if (entries.empty()) return false;
+    BotProcess process;
+    if (!process.start(entries[0].command, options.usePipe)) return false;
+
+    uint8_t message[5], reply[64];
+    for (int i = 0; i < count; i++) {
+        message[0] = MSG_PING;
+        net::writeLE<uint32_t>(message + 1, static_cast<uint32_t>(i));
+        auto start = SteadyClock::now();
+        if (!process.channel().send(message, sizeof(message))) return false;
+        while (true) {
+            long size = process.channel().receive(reply, sizeof(reply), 1000000);
+            if (size <= 0) return false;
+            if (reply[0] == MSG_PONG && size >= 5 && net::readLE<uint32_t>(reply + 1) == static_cast<uint32_t>(i)) break;
+        }
+        samples.push_back(microsSince(start));
+    }
+    return true;
+}
+
+bool bot::Tournament::run()
+{
+    if (entries.empty() || options.matches <= 0) return false;
+    pairings.clear();
+    for (int a = 0; a < static_cast<int>(entries.size()); a++) {
+        for (int b = 0; b < static_cast<int>(entries.size()); b++) {
+            if (a != b || entries.size() == 1) pairings.push_back({ a, b });
+        }
+    }
+
+    results.assign(options.matches, MatchResult());
+    int threads = options.threads > 0 ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    std::atomic<int> next{0};
+    auto start = SteadyClock::now();
+    {
+        utils::ThreadPool pool(threads);
+        for (int t = 0; t < threads; t++) {
+            pool.submit([this, &next] {
+                std::vector<std::unique_ptr<BotProcess>> processes(entries.size() * 2);
+                int index;
+                while ((index = next.fetch_add(1)) < options.matches) {
+                    playMatch(index, processes, results[index]);
+                }
+            });
+        }
+        pool.wait();
+    }
+    wallSeconds = std::chrono::duration<double>(SteadyClock::now() - start).count();
+
+    applyResults();
+    return true;
+}
+
+void bot::Tournament::playMatch(int index, std::vector<std::unique_ptr<BotProcess>>& processes, MatchResult& result)
+{
+    auto pairing = pairings[index % pairings.size()];
+    result.players[0] = pairing.first;
+    result.players[1] = pairing.second;
+
+    BotProcess* bots[2];
+    for (int p = 0; p < 2; p++) {
+        auto& process = processes[result.players[p] * 2 + p];
+        // 上一局崩溃的AI重新启动
+        if (process && !process->isRunning()) process.reset();
+        if (!process) {
+            process.reset(new BotProcess());
+            if (!process->start(entries[result.players[p]].command, options.usePipe)) {
+                result.crashed[p] = true;
+            }
+        }
+        // 复用的AI可能还积压着上一局超时的请求，等它处理完再开始，免得这一局开头几步被算作超时
+        else {
+            waitIdle(*process);
+        }
+        bots[p] = process.get();
+    }
+
+    snake::Round round("Match " + std::to_string(index), 1, options.speed, options.seed + index, 2);
+    std::vector<uint8_t> cells;
+    std::vector<uint8_t> request(MAX_MESSAGE);
+    uint8_t reply[64];
+
+    while (!round.getIsGameOver() && round.getTick() < static_cast<uint32_t>(options.maxTicks)
+            && !result.crashed[0] && !result.crashed[1]) {
+        round.getCells(cells);
+        uint32_t tick = round.getTick();
+        size_t size = MOVE_REQUEST_HEADER + cells.size();
+        if (size > MAX_MESSAGE) break;
+        request[0] = MSG_MOVE_REQUEST;
+        net::writeLE<uint32_t>(&request[5], tick);
+        net::writeLE<uint16_t>(&request[10], static_cast<uint16_t>(round.getBoard().width));
+        net::writeLE<uint16_t>(&request[12], static_cast<uint16_t>(round.getBoard().height));
+        std::copy(cells.begin(), cells.end(), request.begin() + MOVE_REQUEST_HEADER);
+
+        // 两个AI依次询问，各自的计时不受对方影响
+        for (int p = 0; p < 2; p++) {
+            auto snake = round.getSnake(p);
+            uint32_t sequence = bots[p]->nextSequence();
+            net::writeLE<uint32_t>(&request[1], sequence);
+            request[9] = static_cast<uint8_t>(p);
+            net::writeLE<int16_t>(&request[14], static_cast<int16_t>(snake->head->x));
+            net::writeLE<int16_t>(&request[16], static_cast<int16_t>(snake->head->y));
+            request[18] = static_cast<uint8_t>(snake->head->direction);
+
+            auto& channel = bots[p]->channel();
+            auto sent = SteadyClock::now();
+            auto deadline = sent + std::chrono::microseconds(options.budgetUs);
+            if (!channel.send(request.data(), size)) {
+                // 环满说明AI很久没有读取，按超时处理
+                result.timeouts[p]++;
+                continue;
+            }
+            while (true) {
+                long remaining = std::chrono::duration_cast<std::chrono::microseconds>(deadline - SteadyClock::now()).count();
+                long received = remaining > 0 ? channel.receive(reply, sizeof(reply), remaining) : 0;
+                if (received < 0) {
+                    result.crashed[p] = true;
+                    break;
+                }
+                if (received == 0) {
+                    result.timeouts[p]++;
+                    if (!bots[p]->isRunning()) result.crashed[p] = true;
+                    break;
+                }
+                // 超时后才到的旧回复（包括上一局的）直接丢弃
+                if (reply[0] != MSG_MOVE || received < 6 || net::readLE<uint32_t>(reply + 1) != sequence) continue;
+                double micros = microsSince(sent);
+                result.moves[p]++;
+                result.moveMicros[p] += micros;
+                result.maxMoveMicros[p] = std::max(result.maxMoveMicros[p], micros);
+                round.playerMove(static_cast<snake::Direction>(reply[5] & 3), p);
+                break;
+            }
+        }
+        if (result.crashed[0] || result.crashed[1]) break;
+        round.tick();
+    }
+
+    result.ticks = static_cast<int>(round.getTick());
+    if (result.crashed[0] != result.crashed[1]) result.winner = result.crashed[0] ? 1 : 0;
+    else if (!result.crashed[0]) result.winner = round.getWinner();
+}
+
+void bot::Tournament::applyResults()
+{
+    for (auto& entry : entries) {
+        entry.elo = 1500;
+        entry.wins = entry.draws = entry.losses = 0;
+        entry.moves = entry.timeouts = 0;
+        entry.moveMicros = entry.maxMoveMicros = 0;
+    }
+    // 按对局编号顺序更新，结果与线程调度无关
+    for (auto& result : results) {
+        auto& a = entries[result.players[0]];
+        auto& b = entries[result.players[1]];
+        for (int p = 0; p < 2; p++) {
+            auto& entry = entries[result.players[p]];
+            entry.moves += result.moves[p];
+            entry.timeouts += result.timeouts[p];
+            entry.moveMicros += result.moveMicros[p];
+            entry.maxMoveMicros = std::max(entry.maxMoveMicros, result.maxMoveMicros[p]);
+        }
+        if (&a == &b) {
+            a.draws++;
+            continue;
+        }
+
+        double scoreA = result.winner == 0 ? 1.0 : result.winner == 1 ? 0.0 : 0.5;
+        double expectedA = 1.0 / (1.0 + std::pow(10.0, (b.elo - a.elo) / 400.0));
+        a.elo += ELO_K * (scoreA - expectedA);
+        b.elo -= ELO_K * (scoreA - expectedA);
+        if (result.winner == 0) { a.wins++; b.losses++; }
+        else if (result.winner == 1) { b.wins++; a.losses++; }
+        else { a.draws++; b.draws++; }
+    }
+}
+
+void bot::Tournament::report(std::ostream& out) const
+{
+    uint64_t ticks = 0;
+    for (auto& result : results) ticks += result.ticks;
+    out << results.size() << " matches, " << ticks << " ticks in " << std::fixed << std::setprecision(2) << wallSeconds << " s ("
+        << (wallSeconds > 0 ? results.size() / wallSeconds : 0.0) << " matches/s)" << std::endl;
+
+    std::vector<const Entry*> sorted;
+    for (auto& entry : entries) sorted.push_back(&entry);
+    std::sort(sorted.begin(), sorted.end(), [](const Entry* a, const Entry* b) { return a->elo > b->elo; });
+
+    out << std::left << std::setw(16) << "bot" << std::right << std::setw(8) << "elo" << std::setw(8) << "win"
+        << std::setw(8) << "draw" << std::setw(8) << "loss" << std::setw(12) << "moves" << std::setw(12) << "avg us"
+        << std::setw(12) << "max us" << std::setw(10) << "timeouts" << std::endl;
+    for (auto entry : sorted) {
+        out << std::left << std::setw(16) << entry->name << std::right << std::setw(8) << std::setprecision(0) << entry->elo
+            << std::setw(8) << entry->wins << std::setw(8) << entry->draws << std::setw(8) << entry->losses
+            << std::setw(12) << entry->moves << std::setw(12) << std::setprecision(1)
+            << (entry->moves ? entry->moveMicros / entry->moves : 0.0)
+            << std::setw(12) << entry->maxMoveMicros << std::setw(10) << entry->timeouts << std::endl;
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+// 在多个线程上并行进行大量双人对局，每个线程为每个AI保留一个常驻进程，
+// 按每步的时间预算判超时，最后按对局顺序计算Elo分。仅支持Linux。
+
+#include "utils.h"
+#include "bot_protocol.h"
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace bot {
+    struct Entry;
+    struct MatchResult;
+    struct TournamentOptions;
+    class Tournament;
+}
+
+struct bot::Entry {
+    std::string name;
+    std::string command;
+
+    // 以下由Tournament填写
+    double elo = 1500;
+    int wins = 0, draws = 0, losses = 0;
+    uint64_t moves = 0;    // 按时回复的步数
+    uint64_t timeouts = 0;
+    double moveMicros = 0; // 从发出请求到收到回复，包括通信
+    double maxMoveMicros = 0;
+};
+
+struct bot::MatchResult {
+    int players[2];
+    int winner = -1;  // 0或1，平局为-1
+    int ticks = 0;
+    uint64_t moves[2] = {};  // 按时回复的步数
+    uint64_t timeouts[2] = {};
+    double moveMicros[2] = {};
+    double maxMoveMicros[2] = {};
+    bool crashed[2] = {};
+};
+
+struct bot::TournamentOptions {
+    int matches = 1000;
+    int threads = 0;       // 0表示CPU核数
+    long budgetUs = 2000;  // 每步的时间预算，超时这一步保持原方向
+    int maxTicks = 2000;   // 超过后判平局
+    int speed = 5;
+    bool usePipe = false;
+    uint64_t seed = 1;
+};
+
+class bot::Tournament {
+public:
+    Tournament(const std::vector<Entry>& entries, const TournamentOptions& options)
+        : entries(entries), options(options) {}
+
+    bool run();
+    // 测量通信本身的往返时间（微秒），用第一个AI回复PING
+    bool measureRoundTrip(int count, std::vector<double>& samples);
+    void report(std::ostream& out) const;
+
+    const std::vector<Entry>& getEntries() const { return entries; }
+    const std::vector<MatchResult>& getResults() const { return results; }
+
+private:
+    std::vector<Entry> entries;
+    TournamentOptions options;
+    std::vector<MatchResult> results;
+    double wallSeconds = 0;
+
+    std::vector<std::pair<int, int>> pairings; // 所有有序的对阵，先后手轮换
+
+    // processes按 AI下标 * 2 + 玩家编号 存放本线程的AI进程，自己和自己对战时也是两个进程
+    void playMatch(int index, std::vector<std::unique_ptr<BotProcess>>& processes, MatchResult& result);
+    void applyResults();
+};
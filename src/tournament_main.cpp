@@ -0,0 +1,77 @@
+// SpeedSnakeTournament [--bot 名字=命令 ...] [--matches 1000] [--threads N] [--budget-us 2000]
+//                      [--max-ticks 2000] [--pipe] [--seed N] [--pings 10000]
+// 没有--bot时让同目录下SpeedSnakeBot的greedy和random策略对战。
+// 命令交给/bin/sh执行，AI从SNAKE_BOT_SHM环境变量（共享内存）或标准输入输出（--pipe）收发消息。
+
+#include "tournament.h"
+
+#include <signal.h>
+#include <algorithm>
+#include <string>
+
+int main(int argc, char* argv[]){
+    std::vector<bot::Entry> entries;
+    bot::TournamentOptions options;
+    int pings = 10000;
+    for (int i = 1; i < argc; i++) {
+        std::string option = argv[i];
+        if (option == "--pipe") {
+            options.usePipe = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << option << std::endl;
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (option == "--bot") {
+            auto separator = value.find('=');
+            if (separator == std::string::npos) {
+                std::cerr << "--bot expects name=command" << std::endl;
+                return 1;
+            }
+            bot::Entry entry;
+            entry.name = value.substr(0, separator);
+            entry.command = value.substr(separator + 1);
+            entries.push_back(entry);
+        }
+        else if (option == "--matches") options.matches = std::atoi(value.c_str());
+        else if (option == "--threads") options.threads = std::atoi(value.c_str());
+        else if (option == "--budget-us") options.budgetUs = std::atol(value.c_str());
+        else if (option == "--max-ticks") options.maxTicks = std::atoi(value.c_str());
+        else if (option == "--seed") options.seed = std::strtoull(value.c_str(), nullptr, 10);
+        else if (option == "--pings") pings = std::atoi(value.c_str());
+        else std::cerr << "Unknown option: " << option << std::endl;
+    }
+    if (entries.empty()) {
+        std::string self = argv[0];
+        auto slash = self.rfind('/');
+        std::string directory = slash == std::string::npos ? "." : self.substr(0, slash);
+        entries.push_back({ "greedy", directory + "/SpeedSnakeBot --strategy greedy" });
+        entries.push_back({ "random", directory + "/SpeedSnakeBot --strategy random" });
+    }
+
+    utils::verbose = false;
+    // AI进程退出后写管道不应该杀掉比赛程序
+    signal(SIGPIPE, SIG_IGN);
+
+    bot::Tournament tournament(entries, options);
+    std::cout << "Transport: " << (options.usePipe ? "pipe" : "shared memory + futex") << std::endl;
+
+    std::vector<double> samples;
+    if (pings > 0) {
+        if (!tournament.measureRoundTrip(pings, samples)) {
+            std::cerr << "Bot " << entries[0].name << " did not answer ping" << std::endl;
+            return 1;
+        }
+        std::sort(samples.begin(), samples.end());
+        double sum = 0;
+        for (auto sample : samples) sum += sample;
+        std::cout << "Round trip over " << samples.size() << " pings: avg " << sum / samples.size()
+            << " us, p50 " << samples[samples.size() / 2] << " us, p99 " << samples[samples.size() * 99 / 100] << " us" << std::endl;
+    }
+
+    if (!tournament.run()) return 1;
+    tournament.report(std::cout);
+    return 0;
+}
@@ -36,15 +36,45 @@ const bool snake::inGrid(int x, int y)
     return (x >= 0 && x < constants::GRID_NUMBER && y >= 0 && y < constants::GRID_NUMBER);
 }
 
-SDL_FRect snake::getDrect(int grid_x, int grid_y)
+SDL_FRect snake::getDrect(int grid_x, int grid_y, float cellSize)
 {
-    SDL_FRect drect({   (grid_x + 0.5f) * constants::GRID_SIZE - constants::GAP + constants::GRID_X, 
-                        (grid_y + 0.5f) * constants::GRID_SIZE - constants::GAP + constants::GRID_Y, 
-                        constants::GRID_SIZE - constants::GAP * 2, 
-                        constants::GRID_SIZE - constants::GAP * 2 });
+    // 间隙随格子一起缩放
+    float gap = constants::GAP * cellSize / constants::GRID_SIZE;
+    SDL_FRect drect({   (grid_x + 0.5f) * cellSize - gap + constants::GRID_X, 
+                        (grid_y + 0.5f) * cellSize - gap + constants::GRID_Y, 
+                        cellSize - gap * 2, 
+                        cellSize - gap * 2 });
     return drect;
 }
 
+snake::Direction snake::autopilot(Round& round, utils::Rng& rng, int player)
+{
+    static const int dx[4] = { 0, -1, 0, 1 };
+    static const int dy[4] = { -1, 0, 1, 0 };
+    auto snake = round.getSnake(player);
+    auto& board = round.getBoard();
+    auto& reach = round.getReachability();
+    int current = snake->head->direction;
+
+    int best = current;
+    long bestScore = -1;
+    for (int d = 0; d < 4; d++) {
+        if ((d + 2) % 4 == current) continue;
+        int x = snake->head->x + dx[d], y = snake->head->y + dy[d];
+        if (board.blocked(x, y)) continue;
+        int distance = 1 << 20;
+        for (auto apple : round.getApples()) {
+            distance = std::min(distance, std::abs(apple->grid_x - x) + std::abs(apple->grid_y - y));
+        }
+        long score = static_cast<long>(reach.regionSize(x, y)) * 1024 - distance * 8 + rng.below(8 * (rng.below(10) == 0 ? 64 : 1));
+        if (score > bestScore) {
+            bestScore = score;
+            best = d;
+        }
+    }
+    return static_cast<Direction>(best);
+}
+
 void utils::test_utils()
 {
     std::cout << "utils.cpp: Testing utils..." << std::endl;
@@ -52,6 +82,7 @@ void utils::test_utils()
 
 std::mt19937 utils::rng_loc(std::chrono::high_resolution_clock::now().time_since_epoch().count());
 // std::random_device{}()
+bool utils::verbose = true;
 
 uint8_t snake::snakehead_pixel[4*4] = {255, 0, 0, 255,
                                         0, 255, 0, 255,
@@ -61,6 +92,14 @@ uint8_t snake::snakebody_pixel[4*4] = {255, 255, 255, 255,
                                         255, 255, 255, 255,
                                         255, 255, 255, 255,
                                         255, 255, 255, 255 };
+uint8_t snake::snakehead2_pixel[4*4] = {0, 255, 255, 255,
+                                        255, 0, 255, 255,
+                                        255, 255, 0, 255,
+                                        0, 128, 255, 255 };
+uint8_t snake::snakebody2_pixel[4*4] = {64, 160, 255, 255,
+                                        64, 160, 255, 255,
+                                        64, 160, 255, 255,
+                                        64, 160, 255, 255 };
 uint8_t snake::snakeapple_pixel[16*4] = {0, 0, 0, 0, 50, 20, 150, 255, 50, 20, 150, 255, 0, 0, 0, 0,
                                         50, 20, 150, 255, 50, 20, 150, 255, 50, 20, 150, 255, 50, 20, 150, 255,
                                         50, 20, 150, 255, 50, 20, 150, 255, 50, 20, 150, 255, 50, 20, 150, 255,
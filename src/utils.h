@@ -1,13 +1,21 @@
 #pragma once
 
 #include "constants.h"
+#include "snapshot.h"
+#include "reachability.h"
+#include "assets.h"
+#include "level.h"
+#include "resources.h"
 
 #include <SDL3/SDL.h>
 #include <SDL3_image/SDL_image.h>
 #include <SDL3_ttf/SDL_ttf.h>
 // #include <SDL2/SDL_mixer.h>
 #include <iostream>
+#include <algorithm>
 #include <chrono>
+#include <cstdint>
+#include <cstring>
 #include <vector>
 #include <random>
 #include <set>
@@ -21,27 +29,35 @@ namespace snake {
     extern uint8_t snakehead_pixel[4*4];
     extern uint8_t snakebody_pixel[4*4];
     extern uint8_t snakeapple_pixel[16*4];
+    extern uint8_t snakehead2_pixel[4*4]; //第二个玩家
+    extern uint8_t snakebody2_pixel[4*4];
 
     struct SnakeData; // 构成链表的node，存储蛇的数据
 
     class Renderable;
     class Snake;
     class Apple;
+    class Board;
     class Round;
     enum Direction { NORTH, WEST, SOUTH, EAST };
+    // Round产生的事件，供音效等外部模块使用
+    enum Event { EVENT_EAT = 1, EVENT_TURN = 2, EVENT_SPEED_UP = 4, EVENT_GAME_OVER = 8, EVENT_TRAPPED = 16 };
 
     void testing();
     void snakePrevLocation(SnakeData* currData, int &prevX, int &prevY);
     const bool inGrid(int x, int y);
-    SDL_FRect getDrect(int grid_x, int grid_y);
+    // 格子在窗口中的位置，cellSize为每格的像素数
+    SDL_FRect getDrect(int grid_x, int grid_y, float cellSize = constants::GRID_SIZE);
 }
 
 namespace utils {
     void test_utils();
 
     class Timer;
+    class Rng;
 
     extern std::mt19937 rng_loc; //随机数
+    extern bool verbose; //是否输出每局的游戏日志，服务器等无界面场景下关闭
 }
 
 class utils::Timer {
@@ -83,38 +99,54 @@ public:
     }
 };
 
+// splitmix64，状态只有8字节，可以直接存进快照。满足UniformRandomBitGenerator，可配合std的分布使用。
+class utils::Rng {
+public:
+    using result_type = uint32_t;
+    uint64_t state;
+    explicit Rng(uint64_t seed = 0) : state(seed) {}
+
+    static constexpr result_type min() { return 0; }
+    static constexpr result_type max() { return UINT32_MAX; }
+
+    result_type operator()() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return static_cast<result_type>((z ^ (z >> 31)) >> 32);
+    }
+
+    // [0, n)内的随机数。不用std的分布，保证不同编译器上结果一致
+    uint32_t below(uint32_t n) {
+        return static_cast<uint32_t>((static_cast<uint64_t>((*this)()) * n) >> 32);
+    }
+};
+
 class snake::Renderable {
 public:
     int grid_x, grid_y;
-    SDL_FRect drect;
-    SDL_Surface* surface;
-    Renderable(int grid_x, int grid_y, int pixelX, int pixelY, uint8_t* pixels, int pitch) {
+    SDL_Texture* texture = nullptr; //所有同样的精灵共用assets::shared()中的纹理，第一次绘制时获取，无界面运行时不需要SDL
+    int pixelX, pixelY, pitch;
+    uint8_t* pixels;
+    Renderable(int grid_x, int grid_y, int pixelX, int pixelY, uint8_t* pixels, int pitch)
+            : pixelX(pixelX), pixelY(pixelY), pitch(pitch), pixels(pixels) {
         this->grid_x = grid_x;
         this->grid_y = grid_y;
-        this->surface = SDL_CreateSurfaceFrom(pixelX, pixelY, SDL_PIXELFORMAT_RGBA8888, pixels, pitch);
-        if (!surface) {
-            std::cerr << "Failed to create surface: " << SDL_GetError() << std::endl;
-            std::cout << "pitch: " << pitch << std::endl;
-        }
-        drect = SDL_FRect({ (grid_x + 0.5f) * constants::GRID_SIZE - constants::GAP + constants::GRID_X, 
-                    (grid_y + 0.5f) * constants::GRID_SIZE - constants::GAP + constants::GRID_Y, 
-                    constants::GRID_SIZE - constants::GAP * 2, 
-                    constants::GRID_SIZE - constants::GAP * 2 });
     }
     ~Renderable() {
-        SDL_DestroySurface(surface);
+        assets::shared().release(texture);
         // std::cout << "Renderable destroyed at " << grid_x << ", " << grid_y << std::endl;
     }
-    void draw(SDL_Renderer* renderer) {
-        SDL_Texture* texture = SDL_CreateTextureFromSurface(renderer, surface);
+    void draw(SDL_Renderer* renderer, float cellSize = constants::GRID_SIZE) {
         if (!texture) {
-            std::cerr << "Failed to create texture at " << grid_x << ", " << grid_y << ": " << SDL_GetError() << std::endl;
-            return;
+            texture = assets::shared().acquirePixels(renderer, pixels, pixelX, pixelY, pitch);
+            if (!texture) {
+                std::cerr << "Failed to create texture at " << grid_x << ", " << grid_y << std::endl;
+                return;
+            }
         }
-        SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_NONE);
-        SDL_SetTextureScaleMode(texture, SDL_SCALEMODE_NEAREST);
+        SDL_FRect drect = getDrect(grid_x, grid_y, cellSize);
         SDL_RenderTexture(renderer, texture, NULL, &drect);
-        SDL_DestroyTexture(texture);
     }
 };
 
@@ -126,17 +158,13 @@ struct snake::SnakeData
     SnakeData* next;
     SnakeData* prev;
 
-    SDL_Texture* texture = nullptr;
-    SnakeData(int x, int y, Direction direction = NORTH) : x(x), y(y), direction(direction), next(nullptr) {}
+    SnakeData(int x, int y, Direction direction = NORTH) : x(x), y(y), direction(direction), next(nullptr), prev(nullptr) {}
     void setNext(SnakeData* nextData) {
         next = nextData;
     }
     void setPrev(SnakeData* prevData) {
         prev = prevData;
     }
-    void setTexture(SDL_Texture* texture) {
-        this->texture = texture;
-    }
 };
 
 class snake::Snake {
@@ -146,11 +174,14 @@ public:
     int length;
     Direction newDirection;
 
-    SDL_Surface* headSurface;
-    SDL_Surface* bodySurface;
+    SDL_Texture* headTexture = nullptr; //共用assets::shared()中的精灵纹理，第一次绘制时获取
+    SDL_Texture* bodyTexture = nullptr;
 
     // 蛇身是否在增加
     bool growing = false;
+    bool dead = false;
+    int score = 0; //这条蛇吃到的苹果
+    int player = 0; //玩家编号，决定颜色
     Snake(int grid_x, int grid_y, int initLength = 3, Direction initDirection = NORTH) {
         if (initLength < 2 || initLength > 10) {
             std::cerr << "Invalid initLength: " << initLength << ", replaced with 3." << std::endl;
@@ -159,7 +190,7 @@ public:
 
         length = initLength;
 
-        std::cout << "Snake Length: " << length << std::endl;
+        if (utils::verbose) std::cout << "Snake Length: " << length << std::endl;
 
         // 构建链表
         head = new SnakeData(grid_x, grid_y, initDirection);
@@ -187,54 +218,52 @@ public:
         tail->setNext(nullptr);
         
         newDirection = initDirection; //初始化方向
+    }
+    // 从快照恢复，directions为从蛇尾到蛇头每一节的方向
+    Snake(int tailX, int tailY, const std::vector<uint8_t>& directions, Direction newDirection, bool growing) {
+        length = directions.size();
+
+        tail = new SnakeData(tailX, tailY, static_cast<Direction>(directions[0]));
+        auto next = tail;
+        for (size_t i = 1; i < directions.size(); i++) {
+            // 每一节都在后一节的基础上沿自己的方向走一步
+            auto data = new SnakeData(next->x, next->y, static_cast<Direction>(directions[i]));
+            snakePrevLocation(data, data->x, data->y);
+            data->setNext(next);
+            next->setPrev(data);
+            next = data;
+        }
+        head = next;
 
-        // 创建表面
-        this->headSurface = SDL_CreateSurfaceFrom(2, 2, SDL_PIXELFORMAT_RGBA8888, snakehead_pixel, 8);
-        this->bodySurface = SDL_CreateSurfaceFrom(2, 2, SDL_PIXELFORMAT_RGBA8888, snakebody_pixel, 8);
+        this->newDirection = newDirection;
+        this->growing = growing;
     }
     ~Snake() {
-        SDL_DestroySurface(headSurface);
-        SDL_DestroySurface(bodySurface);
+        assets::shared().release(headTexture);
+        assets::shared().release(bodyTexture);
         SnakeData* curr = head;
         while (curr) {
             SnakeData* next = curr->next;
-            SDL_DestroyTexture(curr->texture);
             delete curr;
             curr = next;
         }
     }
-    void draw(SDL_Renderer* renderer) {
-        // 绘制蛇头，每次都要重新绘制因为蛇头一直变化
-        head->setTexture(SDL_CreateTextureFromSurface(renderer, headSurface));
-        SDL_SetTextureBlendMode(head->texture, SDL_BLENDMODE_NONE);
-        SDL_SetTextureScaleMode(head->texture, SDL_SCALEMODE_NEAREST);
-        SDL_FRect drect = getDrect(head->x, head->y);
-        SDL_RenderTexture(renderer, head->texture, NULL, &drect);
-
-        // 绘制第二节蛇身，每次都要重新绘制因为第二节蛇身从蛇头变化得来
-        auto curr = head->next;
-        curr->setTexture(SDL_CreateTextureFromSurface(renderer, bodySurface));
-        SDL_SetTextureBlendMode(curr->texture, SDL_BLENDMODE_NONE);
-        SDL_SetTextureScaleMode(curr->texture, SDL_SCALEMODE_NEAREST);
-        drect = getDrect(curr->x, curr->y);
-        SDL_RenderTexture(renderer, curr->texture, NULL, &drect);
-
-        for (curr = curr->next; curr; curr = curr->next) {
-            // 绘制蛇身，第二节以后的蛇身仅在初始化重绘即可
-            if (curr->texture != nullptr){
-                drect = getDrect(curr->x, curr->y);
-                SDL_RenderTexture(renderer, curr->texture, NULL, &drect);
-                continue;
+    void draw(SDL_Renderer* renderer, float cellSize = constants::GRID_SIZE) {
+        // 每一节都用同一张纹理，原先每帧为蛇头和第二节新建纹理而不释放
+        if (!headTexture || !bodyTexture) {
+            auto& assetManager = assets::shared();
+            if (!headTexture) headTexture = assetManager.acquirePixels(renderer, player == 0 ? snakehead_pixel : snakehead2_pixel, 2, 2, 8);
+            if (!bodyTexture) bodyTexture = assetManager.acquirePixels(renderer, player == 0 ? snakebody_pixel : snakebody2_pixel, 2, 2, 8);
+            if (!headTexture || !bodyTexture) {
+                std::cerr << "Snake: Failed to create textures" << std::endl;
+                return;
             }
-            auto temp = SDL_CreateTextureFromSurface(renderer, bodySurface);
-
-            if (!temp) std::cerr << "Snake: Failed to create body texture: " << SDL_GetError() << std::endl;
-
-            curr->setTexture(temp);
-            SDL_SetTextureBlendMode(curr->texture, SDL_BLENDMODE_NONE);
-            SDL_SetTextureScaleMode(curr->texture, SDL_SCALEMODE_NEAREST);
-            drect = getDrect(curr->x, curr->y);
-            SDL_RenderTexture(renderer, curr->texture, NULL, &drect);
+        }
+        SDL_FRect drect = getDrect(head->x, head->y, cellSize);
+        SDL_RenderTexture(renderer, headTexture, NULL, &drect);
+        for (auto curr = head->next; curr; curr = curr->next) {
+            drect = getDrect(curr->x, curr->y, cellSize);
+            SDL_RenderTexture(renderer, bodyTexture, NULL, &drect);
         }
     }
 
@@ -300,6 +329,7 @@ public:
         newHead->setNext(head);
         head->setPrev(newHead);
         head = newHead;
+        length += 1;
     }
 
     void updateTail() {
@@ -310,6 +340,7 @@ public:
             tail->setNext(nullptr);
             curr->setPrev(nullptr);
             delete curr;
+            length -= 1;
         }
         else {
             growing = false;
@@ -325,29 +356,130 @@ public:
 class snake::Apple : public Renderable {
 public:
     Apple(int grid_x, int grid_y): Renderable(grid_x, grid_y, 4, 4, snakeapple_pixel, 16) {
-        std::cout << "Generate apple at: " << grid_x << ", " << grid_y << std::endl;
+        if (utils::verbose) std::cout << "Generate apple at: " << grid_x << ", " << grid_y << std::endl;
     }
     ~Apple() {
     }
 };
 
+// 扁平的格子占用表，四周多一圈墙。代替原先的三个std::set，可以直接按下标查询和整体复制。
+class snake::Board {
+public:
+    enum Cell : uint8_t { EMPTY = 0, BODY = 1, APPLE = 2, WALL = 4 };
+
+    int width, height; //不含墙
+    std::vector<uint8_t> cells;
+
+    Board(int width, int height) {
+        resize(width, height);
+    }
+    // 换成新的尺寸，只留下四周的墙。同样大小时不重新分配内存
+    void resize(int width, int height) {
+        this->width = width;
+        this->height = height;
+        cells.assign((width + 2) * (height + 2), EMPTY);
+        for (int i = -1; i <= width; i++) {
+            set(i, -1, WALL);
+            set(i, height, WALL);
+        }
+        for (int i = 0; i < height; i++) {
+            set(-1, i, WALL);
+            set(width, i, WALL);
+        }
+    }
+    bool inside(int x, int y) const {
+        return x >= 0 && x < width && y >= 0 && y < height;
+    }
+    int index(int x, int y) const {
+        return (y + 1) * (width + 2) + (x + 1);
+    }
+    uint8_t at(int x, int y) const {
+        return cells[index(x, y)];
+    }
+    void set(int x, int y, uint8_t flag) {
+        cells[index(x, y)] |= flag;
+    }
+    void clear(int x, int y, uint8_t flag) {
+        cells[index(x, y)] &= ~flag;
+    }
+    // 蛇头进入即死亡
+    bool blocked(int x, int y) const {
+        return at(x, y) & (BODY | WALL);
+    }
+    // 清空蛇身和苹果，保留墙
+    void reset() {
+        for (auto& cell : cells) cell &= WALL;
+    }
+    // 墙的FNV-1a，存档据此判断是不是同一张地图。一次取8格，大地图上逐字节算要几十毫秒
+    uint32_t wallHash() const {
+        const uint64_t walls = 0x0101010101010101ull * WALL;
+        uint64_t hash = 14695981039346656037ull;
+        size_t i = 0;
+        for (; i + 8 <= cells.size(); i += 8) {
+            uint64_t word;
+            std::memcpy(&word, &cells[i], 8);
+            hash = (hash ^ (word & walls)) * 1099511628211ull;
+        }
+        for (; i < cells.size(); i++) hash = (hash ^ (cells[i] & WALL)) * 1099511628211ull;
+        return static_cast<uint32_t>(hash ^ (hash >> 32));
+    }
+};
+
 class snake::Round {
 private:
     std::string name;
-    int score;
-    //目前还没有用，用于调整游戏难度。
-    int level;
+    int score; //所有蛇吃到的苹果总数，决定速度
+    int level; //关卡编号，为1时构造后立即开始
+
+    // 以下由loadLevel设置，默认为20x20无障碍、随机出生、3个苹果、每5分加速一次
+    std::vector<Level::Spawn> spawnPoints; //各玩家的出生点，不够时随机
+    std::vector<Level::SpeedStep> speedCurve;
+    int levelApples = 0; //为0时使用原先固定的3个苹果
+    bool hasWalls = false;
+    SDL_Texture* wallTexture = nullptr; //墙每格一个像素，第一次绘制时创建
     
     utils::Timer tickTimer;
+    double simulatedMs = 0; //已经推进到tickTimer上的哪个时刻
     int TPS;
-
-    Snake* snake = nullptr; //蛇
+    bool highSpeed = false; //高速模式，默认的速度曲线在NORMAL_MAX_TPS之后继续加速
+
+    // 带时间戳的输入，时间为tickTimer上的时刻，按时间排列
+    struct TimedInput {
+        double time;
+        Direction direction;
+        int player;
+    };
+    std::vector<TimedInput> pendingInputs;
+    // 一帧中蛇尾离开的格子，与这一帧的蛇身合起来就是各tick扫过的路径
+    struct SweptCell {
+        int x, y;
+        int player;
+    };
+    std::vector<SweptCell> swept;
+    int updateTicks = 0; //上一次update推进的tick数
+
+    std::vector<Snake*> snakes; //蛇，下标即玩家编号
+    int players = 1; //玩家数量，双人对战时为2
     std::vector<Apple*> apples; //苹果
     int appleCount = 0; //苹果数量
 
-    std::set<std::pair<int, int>> collisionGrids; //发生碰撞的的格子(蛇身)
-    std::set<std::pair<int, int>> occupiedGrids; //已经占用的格子(苹果)
-    std::set<std::pair<int, int>> bounderyGrids; //边界格子
+    Board board; //格子占用情况(蛇身、苹果、边界)
+    uint32_t wallHash = 0; //board.wallHash()，只在地图变化时重算
+    ReachabilityIndex reach; //空闲格子的连通区域，随board增量更新
+    uint8_t trappedMask = 0; //已经报告过被困的蛇
+    utils::Rng rng; //本局的随机数，状态随快照保存
+
+    uint32_t tickCount = 0; //已经进行的tick数
+    uint32_t version = 0; //蛇和苹果每变化一次加一，观战墙据此只更新变化了的棋盘
+    uint32_t mapVersion = 0; //地图尺寸或墙变化时加一
+    uint64_t gameSeed = 0; //本局开始时的随机数状态，加上各tick的输入可以重现整局
+    uint64_t inputHash = 0; //各tick实际生效的方向的FNV-1a
+    uint64_t gameMicros = 0; //按各tick的速度累计的游戏时间
+    bool restored = false; //本局中途读过快照（回退、读档或回滚），不能只靠种子和输入重现
+    TickDelta lastDelta; //最近一个tick的变化，用于回放记录
+    bool appleRemoved = false; //这个tick吃掉的苹果因为地图已满没有重新生成
+    RewindBuffer history; //回放记录，仅单人模式
+    uint8_t events = 0; //上次pollEvents之后发生的事件
 
     bool isGameOver = false; //游戏是否应当结束，在update中更新
     bool isPaused = true; //游戏是否处于暂停状态
@@ -356,52 +488,401 @@ private:
     bool appleHidden = false; //苹果是否隐藏
     bool gridHidden = false; //格子是否隐藏
 
-public:
-    Round(std::string name, int level, int speed = 10): name(name), score(0), level(level), TPS(speed) {
-        if (level == 1) {
-            //设置随机数
-            std::uniform_int_distribution<int> rng_loc(0 + 3, constants::GRID_NUMBER - 1 - 3);
-            std::uniform_int_distribution<int> rng_dir(0, 3);
+    void clearSnakes() {
+        for (auto snake : snakes) {
+            delete snake;
+        }
+        snakes.clear();
+    }
+
+    void clearApples() {
+        for (auto apple : apples) {
+            delete apple;
+        }
+        apples.clear();
+    }
+
+    // 关卡的墙加上已经放下的蛇，供levelFits在不动board的情况下试放。蛇最多MAX_PLAYERS条，逐个比较就够了
+    struct LevelGrid {
+        const Level& level;
+        int width, height;
+        std::vector<std::pair<int, int>> bodies;
+        explicit LevelGrid(const Level& level): level(level), width(level.getWidth()), height(level.getHeight()) {}
+        bool inside(int x, int y) const {
+            return x >= 0 && x < width && y >= 0 && y < height;
+        }
+        bool blocked(int x, int y) const {
+            if (level.isWall(x, y)) return true;
+            for (auto& cell : bodies) {
+                if (cell.first == x && cell.second == y) return true;
+            }
+            return false;
+        }
+        void set(int x, int y, uint8_t) {
+            bodies.push_back({ x, y });
+        }
+    };
+
+    // 蛇头在(x, y)、朝direction的直线蛇身是否都在界内，不压墙也不压board上已经放下的蛇。Grid为Board或LevelGrid
+    template <typename Grid>
+    static bool canSpawn(const Grid& board, int x, int y, int length, Direction direction) {
+        const int dx[4] = { 0, -1, 0, 1 };
+        const int dy[4] = { -1, 0, 1, 0 };
+        for (int k = 0; k < length; k++) {
+            int cx = x - dx[direction] * k, cy = y - dy[direction] * k;
+            if (!board.inside(cx, cy) || board.blocked(cx, cy)) return false;
+        }
+        return true;
+    }
 
-            snake = new Snake(rng_loc(utils::rng_loc), rng_loc(utils::rng_loc), 3, static_cast<Direction>(rng_dir(utils::rng_loc)));
+    template <typename Grid>
+    static void markSpawn(Grid& board, int x, int y, int length, Direction direction) {
+        const int dx[4] = { 0, -1, 0, 1 };
+        const int dy[4] = { -1, 0, 1, 0 };
+        for (int k = 0; k < length; k++) board.set(x - dx[direction] * k, y - dy[direction] * k, Board::BODY);
+    }
+
+    // 从左上角开始顺序查找第一个能出生的位置，找不到时返回false
+    template <typename Grid>
+    static bool scanSpawn(const Grid& board, int length, int& x, int& y, Direction& direction) {
+        for (y = 0; y < board.height; y++) {
+            for (x = 0; x < board.width; x++) {
+                for (int d = 0; d < 4; d++) {
+                    direction = static_cast<Direction>(d);
+                    if (canSpawn(board, x, y, length, direction)) return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // 随机找一个空格子放苹果，尽量放在从蛇头能到达的地方。没有空格子时返回false
+    bool findAppleCell(int headX, int headY, bool checkReach, int& x, int& y) {
+        int tries = 0;
+        do {
+            x = 1 + rng.below(board.width - 2);
+            y = 1 + rng.below(board.height - 2);
+            tries++;
+            // 障碍很密时随机很难找到空格，改为从随机位置开始顺序查找
+            if (tries > constants::REACHABLE_SPAWN_TRIES * 16) {
+                int start = board.index(x, y);
+                for (size_t k = 0; k < board.cells.size(); k++) {
+                    int i = static_cast<int>((start + k) % board.cells.size());
+                    if (board.cells[i] != Board::EMPTY) continue;
+                    x = i % (board.width + 2) - 1;
+                    y = i / (board.width + 2) - 1;
+                    return true;
+                }
+                return false;
+            }
+        } while (board.at(x, y) != Board::EMPTY
+            || (checkReach && tries < constants::REACHABLE_SPAWN_TRIES && !reach.reachableFrom(headX, headY, x, y)));
+        return true;
+    }
+
+    // 关卡能否放下players条蛇和全部苹果。蛇按出生点或顺序查找放下，与spawn找不到随机位置时的做法相同。
+    // 直接查关卡的位图，不为大地图另外展开一张Board
+    bool levelFits(const Level& level) const {
+        LevelGrid test(level);
+        auto& points = level.getSpawns();
+        int used = 0;
+        for (int i = 0; i < players; i++) {
+            int x, y, length = 3;
+            Direction direction;
+            if (i < static_cast<int>(points.size())) {
+                x = points[i].x;
+                y = points[i].y;
+                length = points[i].length;
+                direction = static_cast<Direction>(points[i].direction);
+                if (!canSpawn(test, x, y, length, direction)) return false;
+            }
+            else if (!scanSpawn(test, length, x, y, direction)) {
+                return false;
+            }
+            markSpawn(test, x, y, length, direction);
+            used += length;
+        }
+        return used + level.getAppleCount() <= level.getFreeCells();
+    }
 
+    // 为各玩家放下初始的蛇。scanOnly为false时没有出生点的玩家先随机，随机多次都不行时顺序查找；
+    // 前面随机的蛇可能挡住后面的玩家，这时返回false，由调用者全部改为顺序查找
+    bool placeSnakes(bool scanOnly) {
+        clearSnakes();
+        board.reset();
+        for (int i = 0; i < players; i++) {
+            int x, y, length = 3;
+            Direction direction;
+            if (i < static_cast<int>(spawnPoints.size())) {
+                auto& point = spawnPoints[i];
+                x = point.x;
+                y = point.y;
+                length = point.length;
+                direction = static_cast<Direction>(point.direction);
+            }
+            else {
+                // 单人时随机，双人时各占左右两边，保证初始蛇身不重叠；有墙时重试到不压墙为止
+                int tries = scanOnly ? constants::SPAWN_TRIES : 0;
+                bool found = false;
+                while (!found && tries++ < constants::SPAWN_TRIES) {
+                    x = players == 1 ? 3 + rng.below(std::max(1, board.width - 6)) : (i == 0 ? 3 : board.width - 7) + rng.below(4);
+                    y = 3 + rng.below(std::max(1, board.height - 6));
+                    direction = static_cast<Direction>(rng.below(4));
+                    found = canSpawn(board, x, y, length, direction);
+                }
+                if (!found && !scanSpawn(board, length, x, y, direction)) return false;
+            }
+            snakes.push_back(new Snake(x, y, length, direction));
+            snakes.back()->player = i;
+            markSpawn(board, x, y, length, direction);
+        }
+        return true;
+    }
+
+    // 速度曲线中总分达到的最后一级
+    int curveSpeed(int score) const {
+        int speed = speedCurve.front().TPS;
+        for (auto& step : speedCurve) {
+            if (step.score > score) break;
+            speed = step.TPS;
+        }
+        return speed;
+    }
+
+    // 生成初始的蛇和苹果
+    void spawn() {
+        gameSeed = rng.state;
+        inputHash = 14695981039346656037ull;
+        gameMicros = 0;
+        restored = false;
+        // loadLevel已经确认顺序查找一定放得下
+        if (!placeSnakes(false)) placeSnakes(true);
+
+        clearApples();
+        if (levelApples == 0) {
             appleCount = 3;
             apples.push_back(new Apple(0,0));
             apples.push_back(new Apple(19,0));
             apples.push_back(new Apple(0,19));
+        }
+        else {
+            // placeSnakes已经把蛇写进占用表，苹果只放在空格子上
+            appleCount = levelApples;
+            for (int i = 0; i < appleCount; i++) {
+                int x, y;
+                if (!findAppleCell(0, 0, false, x, y)) break;
+                board.set(x, y, Board::APPLE);
+                apples.push_back(new Apple(x, y));
+            }
+            appleCount = static_cast<int>(apples.size());
+        }
 
-            // 蛇身碰撞体积
+        // 占用表此时只有墙、蛇和苹果，不用再经markBoard清空重写一遍，大地图上每遍都要几毫秒
+        for (auto apple : apples) board.set(apple->grid_x, apple->grid_y, Board::APPLE);
+        reach.rebuild(board);
+        trappedMask = 0;
+
+        tickCount = 0;
+        version++;
+        history.clear();
+        record();
+    }
+
+    // 按蛇和苹果重新填写占用表
+    void markBoard() {
+        board.reset();
+        // 蛇身碰撞体积
+        for (auto snake : snakes) {
             for (auto curr = snake->head; curr; curr = curr->next){
-                collisionGrids.insert(std::make_pair(curr->x, curr->y));
+                board.set(curr->x, curr->y, Board::BODY);
             }
-            // 围墙碰撞体积
-            for (int i = 0; i < constants::GRID_NUMBER; i++){
-                bounderyGrids.insert(std::make_pair(-1, i));
-                bounderyGrids.insert(std::make_pair(i, -1));
-                bounderyGrids.insert(std::make_pair(constants::GRID_NUMBER, i));
-                bounderyGrids.insert(std::make_pair(i, constants::GRID_NUMBER));
+        }
+        for (auto apple : apples) {
+            board.set(apple->grid_x, apple->grid_y, Board::APPLE);
+        }
+        reach.rebuild(board);
+        trappedMask = 0;
+    }
+
+    // 重新开始计时，丢掉还没生效的输入
+    void resetClock() {
+        tickTimer.reset();
+        simulatedMs = 0;
+        pendingInputs.clear();
+        swept.clear();
+        updateTicks = 0;
+    }
+
+    // 时间不晚于time的输入交给这个tick，每个玩家一个，其余的留给之后的tick
+    void applyInputs(double time) {
+        uint8_t applied = 0;
+        for (auto it = pendingInputs.begin(); it != pendingInputs.end() && it->time <= time;) {
+            uint8_t bit = static_cast<uint8_t>(1 << it->player);
+            if (applied & bit) {
+                ++it;
+                continue;
             }
+            applied |= bit;
+            if (it->player < static_cast<int>(snakes.size())) snakes[it->player]->newDirection = it->direction;
+            it = pendingInputs.erase(it);
+        }
+    }
+
+    // 蛇尾扫过、现在已经空出来的格子画成半透明的蛇身
+    void drawSwept(SDL_Renderer* renderer, float size) {
+        for (auto& cell : swept) {
+            auto texture = snakes[cell.player]->bodyTexture;
+            if (!texture || (board.at(cell.x, cell.y) & Board::BODY)) continue;
+            SDL_FRect drect = getDrect(cell.x, cell.y, size);
+            // 蛇身纹理是不透明的（BLENDMODE_NONE），不开混合时alpha不起作用；纹理是共享的，画完恢复
+            SDL_BlendMode mode = SDL_BLENDMODE_NONE;
+            SDL_GetTextureBlendMode(texture, &mode);
+            SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+            SDL_SetTextureAlphaMod(texture, constants::SWEEP_ALPHA);
+            SDL_RenderTexture(renderer, texture, NULL, &drect);
+            SDL_SetTextureAlphaMod(texture, 255);
+            SDL_SetTextureBlendMode(texture, mode);
+        }
+    }
 
-            for (auto apple : apples) {
-                occupiedGrids.insert(std::make_pair(apple->grid_x, apple->grid_y));
+    // 快照中的蛇和苹果是否都在当前地图内。存档可能被改坏，写入占用表之前必须先检查
+    bool fitsBoard(const Snapshot& snapshot) const {
+        const int dx[4] = { 0, -1, 0, 1 };
+        const int dy[4] = { -1, 0, 1, 0 };
+        // 换过关卡后旧地图上的存档不能读入，坐标都在界内也会压在墙上
+        if (snapshot.width != board.width || snapshot.height != board.height || snapshot.walls != wallHash) return false;
+        if (static_cast<int>(snapshot.snakes.size()) != players) return false;
+        for (const auto& state : snapshot.snakes) {
+            if (state.length < 2 || state.body.size() * 4 < state.length) return false;
+            int x = state.tailX, y = state.tailY;
+            for (int k = 0; k < state.length; k++) {
+                if (k > 0) {
+                    x += dx[state.direction(k)];
+                    y += dy[state.direction(k)];
+                }
+                // 撞墙而死的蛇头停在四周的墙上
+                bool onWall = x >= -1 && x <= board.width && y >= -1 && y <= board.height;
+                if (!board.inside(x, y) && !(k == state.length - 1 && state.dead && onWall)) return false;
             }
         }
+        if (snapshot.apples.size() % 2 != 0) return false;
+        for (size_t i = 0; i < snapshot.apples.size(); i += 2) {
+            if (!board.inside(snapshot.apples[i], snapshot.apples[i + 1])) return false;
+        }
+        return true;
+    }
+
+    // 把当前tick写入回放记录
+    void record() {
+        if (players != 1) return;
+        // delta只能改写已有的苹果，苹果变少时存完整快照
+        if (history.needsKeyframe() || appleRemoved) {
+            appleRemoved = false;
+            Snapshot snapshot;
+            saveSnapshot(snapshot);
+            history.pushKeyframe(snapshot);
+        }
+        else {
+            history.pushDelta(lastDelta);
+        }
+    }
+
+public:
+    Round(std::string name, int level, int speed = 10):
+            Round(name, level, speed, (static_cast<uint64_t>(utils::rng_loc()) << 32) | utils::rng_loc()) {}
+    // 指定种子时整个对局只由种子和输入决定，不访问全局的rng_loc，可在多个线程中同时创建
+    Round(std::string name, int level, int speed, uint64_t seed, int players = 1): name(name), score(0), level(level), TPS(speed),
+            players(std::min(players, constants::MAX_PLAYERS)), board(constants::GRID_NUMBER, constants::GRID_NUMBER), rng(seed) {
+        wallHash = board.wallHash();
+        if (level == 1) {
+            spawn();
+        }
     }
     ~Round() {
+        clearSnakes();
+        clearApples();
+        if (wallTexture) resources::destroyTexture(wallTexture);
+    }
+
+    // 换成关卡的地图、出生点、苹果数量和速度曲线，并重新开始。关卡文件在调用后可以关闭
+    // 关卡放不下所有玩家的蛇和苹果时返回false，对局保持不变
+    bool loadLevel(const Level& level) {
+        auto start = Clock::now();
+        if (!levelFits(level)) {
+            std::cerr << "Level " << level.getName() << " has no room for " << players << " snakes and "
+                << level.getAppleCount() << " apples" << std::endl;
+            return false;
+        }
+        board.resize(level.getWidth(), level.getHeight());
+        level.stamp(board);
+        wallHash = board.wallHash();
+        spawnPoints = level.getSpawns();
+        speedCurve = level.getSpeedCurve();
+        levelApples = level.getAppleCount();
+        hasWalls = level.getFreeCells() < level.getWidth() * level.getHeight();
+        if (wallTexture) {
+            resources::destroyTexture(wallTexture);
+            wallTexture = nullptr;
+        }
+        name = level.getName();
+        mapVersion++;
+
+        isGameOver = false;
+        score = 0;
+        if (!speedCurve.empty()) TPS = speedCurve.front().TPS;
+        spawn();
+        resetClock();
+        if (utils::verbose) {
+            std::cout << "Level " << name << " (" << board.width << "x" << board.height << ") loaded in "
+                << std::chrono::duration<double, std::milli>(Clock::now() - start).count() << " ms" << std::endl;
+        }
+        return true;
+    }
+    // 关卡比默认的20x20大时整体缩小，长宽不同时按较长的一边
+    float cellSize() const {
+        return std::min(static_cast<float>(constants::GRID_WIDTH) / board.width, static_cast<float>(constants::GRID_HEIGHT) / board.height);
     }
-    static void drawGrid(SDL_Renderer* renderer, SDL_Color color) {
+
+    // 格子小于4像素时线会连成一片，不画
+    static void drawGrid(SDL_Renderer* renderer, SDL_Color color, int columns = constants::GRID_NUMBER, int rows = constants::GRID_NUMBER, float step = constants::GRID_SIZE) {
+        if (step < 4) return;
         SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
+        float width = columns * step, height = rows * step;
         // 绘制水平线
-        for (int i = 0; i <= constants::GRID_HEIGHT; i += constants::GRID_SIZE) {
-            SDL_RenderLine(renderer, constants::GRID_X, constants::GRID_Y + i, constants::GRID_X + constants::GRID_WIDTH, constants::GRID_Y + i);
+        for (int i = 0; i <= rows; i++) {
+            SDL_RenderLine(renderer, constants::GRID_X, constants::GRID_Y + i * step, constants::GRID_X + width, constants::GRID_Y + i * step);
         }
 
         // 绘制垂直线
-        for (int i = 0; i <= constants::GRID_WIDTH; i += constants::GRID_SIZE) {
-            SDL_RenderLine(renderer, constants::GRID_X + i, constants::GRID_Y, constants::GRID_X + i, constants::GRID_Y + constants::GRID_HEIGHT);
+        for (int i = 0; i <= columns; i++) {
+            SDL_RenderLine(renderer, constants::GRID_X + i * step, constants::GRID_Y, constants::GRID_X + i * step, constants::GRID_Y + height);
         }
     }
 
+    // 墙画成一张每格一个像素的纹理，拉伸到整个格子区域
+    void drawWalls(SDL_Renderer* renderer) {
+        if (!hasWalls) return;
+        if (!wallTexture) {
+            wallTexture = resources::createTexture(renderer, SDL_PIXELFORMAT_RGBA32, SDL_TEXTUREACCESS_STATIC, board.width, board.height);
+            if (!wallTexture) return;
+            SDL_SetTextureScaleMode(wallTexture, SDL_SCALEMODE_NEAREST);
+            SDL_SetTextureBlendMode(wallTexture, SDL_BLENDMODE_BLEND);
+            auto& color = constants::color_frame;
+            std::vector<uint32_t> pixels(static_cast<size_t>(board.width) * board.height, 0);
+            uint32_t wall = static_cast<uint32_t>(color.r) | (static_cast<uint32_t>(color.g) << 8)
+                | (static_cast<uint32_t>(color.b) << 16) | (static_cast<uint32_t>(color.a) << 24);
+            for (int y = 0; y < board.height; y++) {
+                const uint8_t* row = &board.cells[board.index(0, y)];
+                for (int x = 0; x < board.width; x++) {
+                    if (row[x] & Board::WALL) pixels[static_cast<size_t>(y) * board.width + x] = wall;
+                }
+            }
+            SDL_UpdateTexture(wallTexture, nullptr, pixels.data(), board.width * 4);
+        }
+        SDL_FRect rect = {constants::GRID_X, constants::GRID_Y, board.width * cellSize(), board.height * cellSize()};
+        SDL_RenderTexture(renderer, wallTexture, nullptr, &rect);
+    }
+
     static void drawFrame(SDL_Renderer* renderer, SDL_Color color)  {
         SDL_SetRenderDrawColor(renderer, color.r, color.g, color.b, color.a);
         for (int i = 0; i < constants::FRAME_THICKNESS; i++) {
@@ -416,19 +897,24 @@ public:
             SDL_SetRenderDrawColor(renderer, constants::color_gridbg.r, constants::color_gridbg.g, constants::color_gridbg.b, constants::color_gridbg.a);
             SDL_RenderFillRect(renderer, &rect);
             // grid line
-            drawGrid(renderer, constants::color_gridline);
+            drawGrid(renderer, constants::color_gridline, board.width, board.height, cellSize());
             // grid frame
             drawFrame(renderer, constants::color_frame);
         }
+        drawWalls(renderer);
 
+        float size = cellSize();
+        if (!snakeHidden && updateTicks > 1) drawSwept(renderer, size);
         if (!appleHidden) {
             for(auto apple : apples){
-                apple->draw(renderer);
+                apple->draw(renderer, size);
             }
         }
 
         if (!snakeHidden) {
-            snake->draw(renderer);
+            for (auto snake : snakes) {
+                snake->draw(renderer, size);
+            }
         }
     }
 
@@ -444,86 +930,361 @@ public:
     //     snake->handleEvent(event);
     // }
 
+    // 按经过的时间补上应有的tick，速度超过帧率时一帧推进多个tick。
+    // 每个tick开始前先交给它这个tick时间段内的输入，并记下蛇尾要离开的格子
     void update() {
-        // std::cout << "Round update" << std::endl;
+        updateTicks = 0;
+        swept.clear();
 
         // 处理暂停和结束
         if (isPaused || isGameOver) {
-            // std::cout << "fuck 1" << std::endl; 
             return;
         }
 
-        // 计时器
-        if (tickTimer.elapsed() < 1000.0f / TPS) {
-            // std::cout << "fuck 2 " << tickTimer.getStartTime() << " " << 
-            // tickTimer.now() << " " << 
-            // 1000.0f / TPS << std::endl; 
-            return;
+        // 计时器；落后太多时（刚开始、卡顿）不追赶，只推进一个tick
+        double now = tickTimer.elapsed();
+        if (now - simulatedMs > constants::MAX_CATCHUP_MS) simulatedMs = now - 1000.0 / TPS;
+        while (!isGameOver && now - simulatedMs >= 1000.0 / TPS) {
+            simulatedMs += 1000.0 / TPS;
+            applyInputs(simulatedMs);
+            for (auto snake : snakes) {
+                if (!snake->growing) swept.push_back({ snake->tail->x, snake->tail->y, snake->player });
+            }
+            tick();
+            updateTicks++;
         }
-        tickTimer.reset();
+    }
 
-        // 更新蛇的位置
-        if (!snake->growing) {
-            collisionGrids.erase(std::make_pair(snake->tail->x, snake->tail->y));
+    // 推进一个tick，不检查计时器。结果只取决于当前状态和各玩家的输入。
+    void tick() {
+        lastDelta = TickDelta();
+        gameMicros += 1000000 / TPS;
+
+        // 先收起所有蛇尾，再移动蛇头，这样蛇头可以进入刚空出的蛇尾
+        Direction prevDirections[2];
+        for (size_t i = 0; i < snakes.size(); i++) {
+            auto snake = snakes[i];
+            prevDirections[i & 1] = snake->head->direction;
+            if (!snake->growing) {
+                if (i == 0) lastDelta.flags |= TickDelta::POP_TAIL;
+                board.clear(snake->tail->x, snake->tail->y, Board::BODY);
+                reach.free(snake->tail->x, snake->tail->y);
+            }
+            snake->update();
+            if (snake->head->direction != prevDirections[i & 1]) events |= EVENT_TURN;
+            inputHash = (inputHash ^ static_cast<uint8_t>(snake->head->direction)) * 1099511628211ull;
         }
-        snake->update();
 
-        // 获取蛇头移动后的位置
-        int headX = snake->head->x;
-        int headY = snake->head->y;
-        // std::cout << "Snake at: " << headX << ", " << headY << " direction: " << snake->head->direction << std::endl;
+        // 死亡判定：撞墙、撞到任何蛇身，或两个蛇头进入同一格
+        for (size_t i = 0; i < snakes.size(); i++) {
+            int headX = snakes[i]->head->x;
+            int headY = snakes[i]->head->y;
+            bool dead = board.blocked(headX, headY);
+            for (size_t j = 0; j < snakes.size(); j++) {
+                if (j != i && snakes[j]->head->x == headX && snakes[j]->head->y == headY) dead = true;
+            }
+            snakes[i]->dead = dead;
+        }
+        for (auto snake : snakes) {
+            board.set(snake->head->x, snake->head->y, Board::BODY);
+            if (board.inside(snake->head->x, snake->head->y)) reach.block(snake->head->x, snake->head->y);
+            if (snake->dead) {
+                if (utils::verbose) std::cout << "Game Over!" << std::endl;
+                isGameOver = true;
+                events |= EVENT_GAME_OVER;
+            }
+        }
+
+        // 蛇吃到苹果
+        bool ate = false;
+        for (size_t k = 0; k < snakes.size(); k++) {
+            auto snake = snakes[k];
+            if (snake->dead) continue;
+            int headX = snake->head->x;
+            int headY = snake->head->y;
+            for (size_t i = 0; i < apples.size(); i++) {
+                auto& apple = apples[i];
+                if (headX == apple->grid_x && headY == apple->grid_y) {
+                    score += 1;
+                    snake->score += 1;
+                    board.clear(apple->grid_x, apple->grid_y, Board::APPLE);
+                    // 重新生成苹果
+                    delete apple;
+
+                    // 防止重复，并尽量生成在这条蛇能到达的地方；地图已满时这个苹果不再出现
+                    int newX = 0, newY = 0;
+                    if (findAppleCell(headX, headY, true, newX, newY)) {
+                        board.set(newX, newY, Board::APPLE);
+                        apple = new Apple(newX, newY);
+                    }
+                    else {
+                        apples.erase(apples.begin() + i);
+                        appleCount = static_cast<int>(apples.size());
+                        appleRemoved = true;
+                    }
+                    snake->growing = true;
+                    ate = true;
+                    events |= EVENT_EAT;
+
+                    if (k == 0) {
+                        lastDelta.flags |= TickDelta::ATE;
+                        lastDelta.appleIndex = static_cast<uint16_t>(i);
+                        lastDelta.appleX = static_cast<int16_t>(newX);
+                        lastDelta.appleY = static_cast<int16_t>(newY);
+                        lastDelta.rngState = rng.state;
+                    }
+                    break;
+                }
+            }
+        }
+
+        // 调整难度：关卡有速度曲线时按总分查曲线，否则每5分加速一次
+        int speed = TPS;
+        if (ate && speedCurve.empty()) {
+            if (score % 5 == 0 && TPS < constants::NORMAL_MAX_TPS) speed = TPS + 1;
+            else if (highSpeed && TPS >= constants::NORMAL_MAX_TPS) speed = std::min(constants::MAX_TPS, TPS + TPS / 10 + 1);
+        }
+        else if (ate) {
+            speed = curveSpeed(score);
+        }
+        if (speed != TPS) {
+            TPS = speed;
+            lastDelta.flags |= TickDelta::SPEED_UP;
+            lastDelta.TPS = static_cast<uint8_t>(TPS);
+            events |= EVENT_SPEED_UP;
+            if (utils::verbose) std::cout << "Speed up to " << TPS << std::endl;
+        }
 
-        // 死亡判定
-        if (collisionGrids.find(std::make_pair(headX, headY))!= collisionGrids.end() ||
-                bounderyGrids.find(std::make_pair(headX, headY))!= bounderyGrids.end()) {
-            std::cout << "Game Over!" << std::endl;
-            isGameOver = true;
+        // 被困：只报告一次，离开困境后可以再次报告
+        for (size_t i = 0; i < snakes.size(); i++) {
+            uint8_t bit = static_cast<uint8_t>(1 << i);
+            if (!isTrapped(static_cast<int>(i))) trappedMask &= ~bit;
+            else if (!(trappedMask & bit)) {
+                trappedMask |= bit;
+                events |= EVENT_TRAPPED;
+                if (utils::verbose) std::cout << "Snake " << i << " is trapped!" << std::endl;
+            }
         }
 
-        collisionGrids.insert(std::make_pair(snake->head->x, snake->head->y));
+        if (isGameOver) lastDelta.flags |= TickDelta::GAME_OVER;
+        lastDelta.headDirection = static_cast<uint8_t>(snakes[0]->head->direction);
+        lastDelta.newDirection = static_cast<uint8_t>(snakes[0]->newDirection);
 
-        // printCollisionGrids();
+        tickCount += 1;
+        version++;
+        record();
+    }
 
-        // 蛇吃到苹果
-        for (auto& apple : apples) {
-            if (headX == apple->grid_x && headY == apple->grid_y) {
-                score += 1;
-                occupiedGrids.erase(std::make_pair(apple->grid_x, apple->grid_y));
-                // 重新生成苹果
-                std::uniform_int_distribution<int> temp(0 + 1, constants::GRID_NUMBER - 1 - 1);
-                delete apple;
-
-                // 防止重复
-                auto newX = temp(utils::rng_loc);
-                auto newY = temp(utils::rng_loc);
-
-                auto tempPair = std::make_pair(newX, newY);
-                
-                while (collisionGrids.find(tempPair) != collisionGrids.end() ||
-                        occupiedGrids.find(tempPair) != occupiedGrids.end() ||
-                        bounderyGrids.find(tempPair) != bounderyGrids.end()) {
-                    tempPair = std::make_pair(temp(utils::rng_loc), temp(utils::rng_loc));
-                }
-                occupiedGrids.insert(std::make_pair(newX, newY));
-                apple = new Apple(newX, newY);
-                std::cout << "Generate apple at: " << apple->grid_x << ", " << apple->grid_y << std::endl;
-                snake->growing = true;
-                break;
+    void saveSnapshot(Snapshot& snapshot) const {
+        snapshot.width = static_cast<uint16_t>(board.width);
+        snapshot.height = static_cast<uint16_t>(board.height);
+        snapshot.walls = wallHash;
+        snapshot.tick = tickCount;
+        snapshot.score = static_cast<int16_t>(score);
+        snapshot.TPS = static_cast<uint8_t>(TPS);
+        snapshot.isGameOver = isGameOver;
+        snapshot.rngState = rng.state;
+
+        snapshot.snakes.resize(snakes.size());
+        std::vector<uint8_t> directions;
+        for (size_t i = 0; i < snakes.size(); i++) {
+            auto snake = snakes[i];
+            auto& state = snapshot.snakes[i];
+            state.tailX = static_cast<int16_t>(snake->tail->x);
+            state.tailY = static_cast<int16_t>(snake->tail->y);
+            state.newDirection = static_cast<uint8_t>(snake->newDirection);
+            state.growing = snake->growing;
+            state.dead = snake->dead;
+            state.score = static_cast<int16_t>(snake->score);
+
+            // updateHead会改写旧蛇头的direction，所以蛇身方向由相邻两节的坐标得出。
+            // 蛇尾本身的方向不影响坐标，统一记为与第二节相同。
+            directions.clear();
+            directions.push_back(0);
+            for (auto curr = snake->tail; curr->prev; curr = curr->prev) {
+                int dx = curr->prev->x - curr->x;
+                int dy = curr->prev->y - curr->y;
+                Direction direction = dy < 0 ? NORTH : dx < 0 ? WEST : dy > 0 ? SOUTH : EAST;
+                directions.push_back(static_cast<uint8_t>(direction));
+            }
+            directions[0] = directions[1];
+            state.packBody(directions);
+        }
+
+        snapshot.apples.clear();
+        for (auto apple : apples) {
+            snapshot.apples.push_back(static_cast<int16_t>(apple->grid_x));
+            snapshot.apples.push_back(static_cast<int16_t>(apple->grid_y));
+        }
+    }
+
+    // 快照与当前对局不符（玩家数不同，或蛇、苹果不在地图内）时返回false，对局保持不变
+    bool loadSnapshot(const Snapshot& snapshot) {
+        if (!fitsBoard(snapshot)) return false;
+        clearSnakes();
+        std::vector<uint8_t> directions;
+        for (size_t i = 0; i < snapshot.snakes.size(); i++) {
+            const auto& state = snapshot.snakes[i];
+            state.unpackBody(directions);
+            auto snake = new Snake(state.tailX, state.tailY, directions,
+                static_cast<Direction>(state.newDirection), state.growing);
+            snake->dead = state.dead;
+            snake->score = state.score;
+            snake->player = static_cast<int>(i);
+            snakes.push_back(snake);
+        }
+
+        clearApples();
+        for (size_t i = 0; i + 1 < snapshot.apples.size(); i += 2) {
+            apples.push_back(new Apple(snapshot.apples[i], snapshot.apples[i + 1]));
+        }
+        appleCount = apples.size();
+
+        markBoard();
+
+        tickCount = snapshot.tick;
+        score = snapshot.score;
+        TPS = snapshot.TPS;
+        isGameOver = snapshot.isGameOver;
+        rng.state = snapshot.rngState;
+        version++;
+        restored = true;
+        pendingInputs.clear();
+        return true;
+    }
+
+    // 回退ticks个tick，回退后游戏暂停
+    bool rewind(int ticks) {
+        Snapshot snapshot;
+        if (!history.stepBack(ticks, snapshot) || !loadSnapshot(snapshot)) {
+            return false;
+        }
+        if (!isPaused) togglePause();
+        std::cout << "Rewind to tick " << tickCount << std::endl;
+        return true;
+    }
+
+    bool saveToFile(const std::string& path) const {
+        Snapshot snapshot;
+        saveSnapshot(snapshot);
+        if (!writeSnapshotFile(path, snapshot)) {
+            return false;
+        }
+        std::cout << "Game saved to " << path << std::endl;
+        return true;
+    }
+
+    bool loadFromFile(const std::string& path) {
+        Snapshot snapshot;
+        if (!readSnapshotFile(path, snapshot)) {
+            return false;
+        }
+        if (!loadSnapshot(snapshot)) {
+            std::cerr << "Save file does not match this game: " << path << std::endl;
+            return false;
+        }
+        history.clear();
+        record();
+        if (!isPaused) togglePause();
+        std::cout << "Game loaded from " << path << std::endl;
+        return true;
+    }
+
+    // 每格一个字节：0空，1蛇身或关卡里的墙，2苹果，3蛇头，按行排列，不含四周的墙
+    void getCells(std::vector<uint8_t>& cells) const {
+        cells.assign(board.width * board.height, 0);
+        for (int y = 0; y < board.height; y++) {
+            for (int x = 0; x < board.width; x++) {
+                auto cell = board.at(x, y);
+                if (cell & (Board::BODY | Board::WALL)) cells[y * board.width + x] = 1;
+                else if (cell & Board::APPLE) cells[y * board.width + x] = 2;
+            }
+        }
+        for (auto snake : snakes) {
+            if (board.inside(snake->head->x, snake->head->y)) {
+                cells[snake->head->y * board.width + snake->head->x] = 3;
             }
         }
+    }
+    const Board& getBoard() const {
+        return board;
+    }
+    const ReachabilityIndex& getReachability() const {
+        return reach;
+    }
 
-        // 调整难度
-        if (snake->growing && score % 5 == 0 && TPS < 20) {
-            TPS += 1;
-            std::cout << "Speed up to " << TPS << std::endl;
+    // 蛇头能到达的区域装不下整条蛇，并且蛇尾也不在这个区域边上（跟着蛇尾走也出不去），基本必死
+    bool isTrapped(int player = 0) const {
+        auto snake = snakes[player];
+        if (snake->dead) return false;
+        int headX = snake->head->x, headY = snake->head->y;
+        if (reach.regionSizeAround(headX, headY) >= snake->length) return false;
+
+        int tailX = snake->tail->x, tailY = snake->tail->y;
+        if (std::abs(tailX - headX) + std::abs(tailY - headY) == 1) return false;
+        const int dx[4] = { 0, -1, 0, 1 };
+        const int dy[4] = { -1, 0, 1, 0 };
+        for (int d = 0; d < 4; d++) {
+            int x = tailX + dx[d], y = tailY + dy[d];
+            if (board.inside(x, y) && reach.reachableFrom(headX, headY, x, y)) return false;
         }
+        return true;
+    }
 
-        // printOccupiedGridsAndCollisionGrids();
+    // 取出并清空上次调用之后发生的事件
+    uint8_t pollEvents(){
+        auto result = events;
+        events = 0;
+        return result;
     }
     
     const int getScore(){
         return score;
     }
+    int getPlayerScore(int player) const {
+        return snakes[player]->score;
+    }
+    // 对战结束后的胜者，平局或未结束返回-1
+    int getWinner() const {
+        if (!isGameOver || players < 2) return -1;
+        int winner = -1;
+        for (int i = 0; i < players; i++) {
+            if (snakes[i]->dead) continue;
+            if (winner >= 0) return -1;
+            winner = i;
+        }
+        return winner;
+    }
+    Snake* getSnake(int player){
+        return snakes[player];
+    }
+    const std::vector<Apple*>& getApples() const {
+        return apples;
+    }
+    int getPlayers() const {
+        return players;
+    }
+    uint32_t getTick() const {
+        return tickCount;
+    }
+    uint32_t getVersion() const {
+        return version;
+    }
+    uint32_t getMapVersion() const {
+        return mapVersion;
+    }
+    uint64_t getSeed() const {
+        return gameSeed;
+    }
+    uint64_t getInputHash() const {
+        return inputHash;
+    }
+    uint32_t getGameMillis() const {
+        return static_cast<uint32_t>(gameMicros / 1000);
+    }
+    bool getRestored() const {
+        return restored;
+    }
     const int getLevel(){
         return level;
     }
@@ -557,35 +1318,23 @@ public:
         isGameOver = false;
         isPaused = true;
         score = 0;
-        delete snake;
-        std::uniform_int_distribution<int> rng_loc(0 + 3, constants::GRID_NUMBER - 1 - 3);
-        std::uniform_int_distribution<int> rng_dir(0, 3);
-
-        occupiedGrids.clear();
-        collisionGrids.clear();
-        // bounderyGrids.clear();
-
-        snake = new Snake(rng_loc(utils::rng_loc), rng_loc(utils::rng_loc), 3, static_cast<Direction>(rng_dir(utils::rng_loc)));
-        // 蛇身碰撞体积
-        for (auto curr = snake->head; curr; curr = curr->next){
-            collisionGrids.insert(std::make_pair(curr->x, curr->y));
-        }
-
-        apples.clear();
-        appleCount = 3;
-        apples.push_back(new Apple(0,0));
-        apples.push_back(new Apple(19,0));
-        apples.push_back(new Apple(0,19));
+        TPS = speedCurve.empty() ? 5 : speedCurve.front().TPS;
 
-        for (auto apple : apples) {
-            occupiedGrids.insert(std::make_pair(apple->grid_x, apple->grid_y));
-        }
+        spawn();
 
-        std::cout << "Game Restarted!" << std::endl;
+        if (utils::verbose) std::cout << "Game Restarted!" << std::endl;
 
-        TPS = 5;
+        resetClock();
+    }
 
-        tickTimer.reset();
+    void setHighSpeed(bool enabled){
+        highSpeed = enabled;
+    }
+    bool getHighSpeed() const {
+        return highSpeed;
+    }
+    int getUpdateTicks() const {
+        return updateTicks;
     }
 
     void toggleHideSnake(){
@@ -600,14 +1349,34 @@ public:
         gridHidden = !gridHidden;
     }
 
-    void playerMove(const Direction direction){
-        snake->newDirection = direction;
+    void playerMove(const Direction direction, int player = 0){
+        snakes[player]->newDirection = direction;
+    }
+    // 带时间戳的输入：交给时间戳所在的那个tick，而不是下一次update的第一个tick。
+    // 同一玩家在一个tick内的几次输入依次顺延到之后的tick，这样快速连按的两次转向都能生效
+    void playerMoveAt(const Direction direction, int player, Clock::time_point at){
+        double time = tickTimer.elapsed() - std::chrono::duration<double, std::milli>(Clock::now() - at).count();
+        int queued = 0;
+        for (auto& input : pendingInputs) queued += input.player == player;
+        if (queued >= constants::INPUT_QUEUE_LIMIT) return;
+        auto position = std::upper_bound(pendingInputs.begin(), pendingInputs.end(), time,
+            [](double t, const TimedInput& input) { return t < input.time; });
+        pendingInputs.insert(position, { time, direction, player });
     }
 
     void printCollisionGrids() {
         std::cout << "Collision Grids: " << std::endl;
-        for (auto grid : collisionGrids) {
-            std::cout << "(" << grid.first << ", " << grid.second << ") " << std::endl;
+        for (int y = 0; y < board.height; y++) {
+            for (int x = 0; x < board.width; x++) {
+                if (board.at(x, y) & Board::BODY) {
+                    std::cout << "(" << x << ", " << y << ") " << std::endl;
+                }
+            }
         }
     }
-};
\ No newline at end of file
+};
+
+namespace snake {
+    // 简单的AI：往能到达的格子最多的方向走，同样大时往最近的苹果走，偶尔随机
+    Direction autopilot(Round& round, utils::Rng& rng, int player = 0);
+}